@@ -0,0 +1,294 @@
+#include "sshdiscovery.h"
+
+#include <QFile>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <algorithm>
+
+using namespace SshHelper;
+
+namespace
+{
+// About 50 MB, written by benchmarkParse() only.
+constexpr int s_benchmarkLines = 500000;
+constexpr int s_fixtureLines = 3000;
+
+// Three key types per host as ssh writes them, every fifth host hashed (HashKnownHosts yes).
+QByteArray knownHostsData(int lines)
+{
+    static const char *const keyTypes[] = {"ssh-ed25519", "ecdsa-sha2-nistp256", "ssh-rsa"};
+
+    QRandomGenerator random(8);
+    const QByteArray key = QByteArray(68, 'A');
+    QByteArray data;
+    data.reserve(qsizetype(lines) * 120);
+    for (int line = 0; line < lines; ++line) {
+        const int host = line / 3;
+        if (host % 5 == 0) {
+            QByteArray salt(20, Qt::Uninitialized);
+            QByteArray hash(20, Qt::Uninitialized);
+            random.fillRange(reinterpret_cast<quint32 *>(salt.data()), 5);
+            random.fillRange(reinterpret_cast<quint32 *>(hash.data()), 5);
+            data += "|1|" + salt.toBase64() + '|' + hash.toBase64();
+        } else {
+            data += "host" + QByteArray::number(host) + ".example.com,10." + QByteArray::number((host >> 16) & 0xff) + '.'
+                + QByteArray::number((host >> 8) & 0xff) + '.' + QByteArray::number(host & 0xff);
+        }
+        data += ' ';
+        data += keyTypes[line % 3];
+        data += ' ';
+        data += key;
+        data += '\n';
+    }
+    return data;
+}
+
+QByteArray plainLine(const QByteArray &hosts)
+{
+    return hosts + " ssh-ed25519 " + QByteArray(68, 'A') + '\n';
+}
+
+QStringList aliases(const QVector<DiscoveredHost> &hosts, qsizetype from = 0)
+{
+    QStringList names;
+    for (qsizetype i = from; i < hosts.size(); ++i) {
+        names.push_back(hosts.at(i).alias);
+    }
+    return names;
+}
+
+// A known_hosts line as ssh writes it for name with HashKnownHosts yes.
+QByteArray hashedLine(const QString &name, const QByteArray &salt)
+{
+    const QByteArray hash = QMessageAuthenticationCode::hash(name.toUtf8(), salt, QCryptographicHash::Sha1);
+    return "|1|" + salt.toBase64() + '|' + hash.toBase64() + " ssh-ed25519 " + QByteArray(68, 'A') + '\n';
+}
+} // namespace
+
+class KnownHostsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void parsesPlainAndHashedEntries();
+    void updateParsesOnlyAppendedLines();
+    void updateReparsesTruncatedFile();
+    void updateReparsesEditedPrefix();
+    void updateReparsesAfterPartialLine();
+    void updateHandlesEmptyFile();
+    void offersHashedHostNames();
+    void resolvesHashedEntries();
+    void benchmarkParse();
+
+private:
+    bool writeKnownHosts(const QByteArray &data, QIODevice::OpenMode mode = QIODevice::WriteOnly);
+
+    QTemporaryDir m_dir;
+};
+
+bool KnownHostsTest::writeKnownHosts(const QByteArray &data, QIODevice::OpenMode mode)
+{
+    QFile file(m_dir.filePath(QStringLiteral("updated_known_hosts")));
+    return file.open(mode) && file.write(data) == data.size();
+}
+
+void KnownHostsTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+void KnownHostsTest::parsesPlainAndHashedEntries()
+{
+    const QString path = m_dir.filePath(QStringLiteral("known_hosts"));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(file.write(knownHostsData(s_fixtureLines)) > 0);
+    file.close();
+
+    KnownHostsParser parser;
+    QVERIFY(!parser.update(path));
+
+    // Every host name and address once, whatever number of key types it has.
+    const int hosts = (s_fixtureLines + 2) / 3;
+    const int hashed = (hosts + 4) / 5;
+    QCOMPARE(parser.hosts().size(), 2 * (hosts - hashed));
+    QCOMPARE(parser.hashedHosts().size(), 3 * hashed);
+}
+
+void KnownHostsTest::updateParsesOnlyAppendedLines()
+{
+    const QString path = m_dir.filePath(QStringLiteral("updated_known_hosts"));
+    QVERIFY(writeKnownHosts(plainLine("alpha.example.com,10.0.0.1")));
+    KnownHostsParser parser;
+    QVERIFY(!parser.update(path));
+    QCOMPARE(aliases(parser.hosts()), (QStringList{QStringLiteral("alpha.example.com"), QStringLiteral("10.0.0.1")}));
+    QCOMPARE(parser.appendedFrom(), 0);
+
+    // A second key for a known host adds nothing; only the new host is reported as appended.
+    QVERIFY(writeKnownHosts(plainLine("alpha.example.com") + plainLine("[bravo.example.com]:2222"), QIODevice::Append));
+    QVERIFY(parser.update(path));
+    QCOMPARE(parser.hosts().size(), 3);
+    QCOMPARE(parser.appendedFrom(), 2);
+    QCOMPARE(aliases(parser.hosts(), parser.appendedFrom()), QStringList{QStringLiteral("[bravo.example.com]:2222")});
+    QCOMPARE(parser.hosts().constLast().hostName, QStringLiteral("bravo.example.com"));
+
+    // Nothing appended is still an append.
+    QVERIFY(parser.update(path));
+    QCOMPARE(parser.hosts().size(), 3);
+    QCOMPARE(parser.appendedFrom(), 3);
+}
+
+void KnownHostsTest::updateReparsesTruncatedFile()
+{
+    const QString path = m_dir.filePath(QStringLiteral("updated_known_hosts"));
+    QVERIFY(writeKnownHosts(plainLine("alpha.example.com") + plainLine("bravo.example.com")));
+    KnownHostsParser parser;
+    parser.update(path);
+    QCOMPARE(parser.hosts().size(), 2);
+
+    // ssh-keygen -R rewrites the file without the removed host.
+    QVERIFY(writeKnownHosts(plainLine("bravo.example.com")));
+    QVERIFY(!parser.update(path));
+    QCOMPARE(aliases(parser.hosts()), QStringList{QStringLiteral("bravo.example.com")});
+    QCOMPARE(parser.appendedFrom(), 0);
+}
+
+void KnownHostsTest::updateReparsesEditedPrefix()
+{
+    const QString path = m_dir.filePath(QStringLiteral("updated_known_hosts"));
+    QVERIFY(writeKnownHosts(plainLine("alpha.example.com") + plainLine("bravo.example.com")));
+    KnownHostsParser parser;
+    parser.update(path);
+
+    // Same size, one host renamed in place, and a line appended after it.
+    QVERIFY(writeKnownHosts(plainLine("alpha.example.org") + plainLine("bravo.example.com") + plainLine("charlie.example.com")));
+    QVERIFY(!parser.update(path));
+    QCOMPARE(aliases(parser.hosts()),
+             (QStringList{QStringLiteral("alpha.example.org"), QStringLiteral("bravo.example.com"), QStringLiteral("charlie.example.com")}));
+}
+
+void KnownHostsTest::updateReparsesAfterPartialLine()
+{
+    const QString path = m_dir.filePath(QStringLiteral("updated_known_hosts"));
+    QByteArray partial = plainLine("alpha.example.com");
+    partial.chop(1);
+    QVERIFY(writeKnownHosts(partial + "AA"));
+    KnownHostsParser parser;
+    parser.update(path);
+    QCOMPARE(parser.hosts().size(), 1);
+
+    // The last line was still being written; it is parsed again together with what follows it.
+    QVERIFY(writeKnownHosts("AA
+" + plainLine("bravo.example.com"), QIODevice::Append));
+    QVERIFY(!parser.update(path));
+    QCOMPARE(aliases(parser.hosts()), (QStringList{QStringLiteral("alpha.example.com"), QStringLiteral("bravo.example.com")}));
+}
+
+void KnownHostsTest::updateHandlesEmptyFile()
+{
+    const QString path = m_dir.filePath(QStringLiteral("updated_known_hosts"));
+    QVERIFY(writeKnownHosts(QByteArray()));
+    KnownHostsParser parser;
+    parser.update(path);
+    QVERIFY(parser.hosts().isEmpty());
+    QVERIFY(parser.hashedHosts().isEmpty());
+
+    QVERIFY(writeKnownHosts(plainLine("alpha.example.com") + hashedLine(QStringLiteral("bravo.example.com"), QByteArray(20, 'b'))));
+    parser.update(path);
+    QCOMPARE(parser.hosts().size(), 1);
+    QCOMPARE(parser.hashedHosts().size(), 1);
+
+    // Emptied, then removed: every entry goes, hashed ones included.
+    QVERIFY(writeKnownHosts(QByteArray()));
+    QVERIFY(!parser.update(path));
+    QVERIFY(parser.hosts().isEmpty());
+    QVERIFY(parser.hashedHosts().isEmpty());
+
+    QVERIFY(QFile::remove(path));
+    parser.update(path);
+    QVERIFY(parser.hosts().isEmpty());
+    QCOMPARE(parser.appendedFrom(), 0);
+}
+
+void KnownHostsTest::offersHashedHostNames()
+{
+    QSet<QString> names;
+    addHashedHostNames(names, QStringLiteral("Web.Example.COM."), 2222);
+    addHashedHostNames(names, QStringLiteral("root@[db.example.com]:2200"));
+    addHashedHostNames(names, QStringLiteral("plain.example.com"), 22);
+    addHashedHostNames(names, QStringLiteral("[fe80::1%eth0]"));
+    addHashedHostNames(names, QString());
+
+    const QSet<QString> expected = {
+        QStringLiteral("web.example.com"),
+        QStringLiteral("[web.example.com]:2222"),
+        QStringLiteral("db.example.com"),
+        QStringLiteral("[db.example.com]:2200"),
+        QStringLiteral("plain.example.com"),
+        QStringLiteral("fe80::1%eth0"),
+    };
+    QCOMPARE(names, expected);
+}
+
+void KnownHostsTest::resolvesHashedEntries()
+{
+    const QString path = m_dir.filePath(QStringLiteral("hashed_known_hosts"));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(hashedLine(QStringLiteral("[web.example.com]:2222"), QByteArray(20, 'a')));
+    file.write(hashedLine(QStringLiteral("db.example.com"), QByteArray(20, 'b')));
+    file.write(hashedLine(QStringLiteral("unknown.example.com"), QByteArray(20, 'c')));
+    file.close();
+
+    KnownHostsParser parser;
+    parser.update(path);
+    QVERIFY(parser.hosts().isEmpty());
+    QCOMPARE(parser.hashedHosts().size(), 3);
+
+    QSet<QString> candidates;
+    addHashedHostNames(candidates, QStringLiteral("Web.Example.com"), 2222);
+    addHashedHostNames(candidates, QStringLiteral("DB.example.com"));
+
+    HashedHostMatcher matcher(m_dir.filePath(QStringLiteral("known_hosts_hashes")));
+    QVector<DiscoveredHost> hosts = matcher.match(parser.hashedHosts(), candidates);
+    std::sort(hosts.begin(), hosts.end(), [](const DiscoveredHost &lhs, const DiscoveredHost &rhs) {
+        return lhs.alias < rhs.alias;
+    });
+    QCOMPARE(hosts.size(), 2);
+    QCOMPARE(hosts.at(0).alias, QStringLiteral("[web.example.com]:2222"));
+    QCOMPARE(hosts.at(0).hostName, QStringLiteral("web.example.com"));
+    QCOMPARE(hosts.at(1).alias, QStringLiteral("db.example.com"));
+    QCOMPARE(hosts.at(1).hostName, QStringLiteral("db.example.com"));
+
+    // Results are cached, so a matcher reading them back resolves without hashing again.
+    QVERIFY(matcher.save());
+    HashedHostMatcher reloaded(m_dir.filePath(QStringLiteral("known_hosts_hashes")));
+    reloaded.load();
+    QCOMPARE(reloaded.match(parser.hashedHosts(), candidates).size(), 2);
+}
+
+void KnownHostsTest::benchmarkParse()
+{
+    const QString path = m_dir.filePath(QStringLiteral("benchmark_known_hosts"));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(file.write(knownHostsData(s_benchmarkLines)) > 0);
+    file.close();
+
+    qsizetype hosts = 0;
+    QBENCHMARK {
+        KnownHostsParser parser;
+        parser.update(path);
+        hosts = parser.hosts().size();
+    }
+    QVERIFY(hosts > 0);
+    QFile::remove(path);
+}
+
+QTEST_GUILESS_MAIN(KnownHostsTest)
+
+#include "knownhoststest.moc"
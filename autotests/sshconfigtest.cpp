@@ -0,0 +1,172 @@
+#include "sshdiscovery.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <memory>
+
+using namespace SshHelper;
+
+namespace
+{
+QStringList aliases(const QVector<DiscoveredHost> &hosts)
+{
+    QStringList names;
+    for (const DiscoveredHost &host : hosts) {
+        names.push_back(host.alias);
+    }
+    return names;
+}
+
+const DiscoveredHost *findHost(const QVector<DiscoveredHost> &hosts, const QString &alias)
+{
+    for (const DiscoveredHost &host : hosts) {
+        if (host.alias == alias) {
+            return &host;
+        }
+    }
+    return nullptr;
+}
+} // namespace
+
+class SshConfigTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void includesInOrder();
+    void expandsIncludeGlobs();
+    void resumesEnclosingBlock();
+    void stopsAtIncludeCycles();
+
+private:
+    // Writes a file under the fixture directory, creating its parent directories.
+    bool writeFile(const QString &relativePath, const QByteArray &data);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+    QString m_configPath;
+};
+
+void SshConfigTest::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    m_configPath = m_dir->filePath(QStringLiteral("config"));
+}
+
+void SshConfigTest::cleanup()
+{
+    m_dir.reset();
+}
+
+bool SshConfigTest::writeFile(const QString &relativePath, const QByteArray &data)
+{
+    const QString path = m_dir->filePath(relativePath);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+void SshConfigTest::includesInOrder()
+{
+    // Relative includes resolve against the directory of the config, like ~/.ssh for ssh.
+    QVERIFY(writeFile(QStringLiteral("config"), "Host first\nInclude conf.d/b.conf conf.d/a.conf\nInclude conf.d/c.conf\nHost last\n"));
+    QVERIFY(writeFile(QStringLiteral("conf.d/a.conf"), "Host alpha\n"));
+    QVERIFY(writeFile(QStringLiteral("conf.d/b.conf"), "Host bravo\nInclude conf.d/nested.conf\n"));
+    QVERIFY(writeFile(QStringLiteral("conf.d/c.conf"), "Host charlie\n"));
+    QVERIFY(writeFile(QStringLiteral("conf.d/nested.conf"), "Host nested\n"));
+
+    const QVector<DiscoveredHost> hosts = discoverConfigHosts(m_configPath);
+    QCOMPARE(aliases(hosts), (QStringList{QStringLiteral("first"),
+                                          QStringLiteral("bravo"),
+                                          QStringLiteral("nested"),
+                                          QStringLiteral("alpha"),
+                                          QStringLiteral("charlie"),
+                                          QStringLiteral("last")}));
+}
+
+void SshConfigTest::expandsIncludeGlobs()
+{
+    QVERIFY(writeFile(QStringLiteral("config"), "Include conf.d/*.conf missing/*.conf\nHost last\n"));
+    QVERIFY(writeFile(QStringLiteral("conf.d/20-bravo.conf"), "Host bravo\n"));
+    QVERIFY(writeFile(QStringLiteral("conf.d/10-alpha.conf"), "Host alpha\n"));
+    QVERIFY(writeFile(QStringLiteral("conf.d/30-ignored.txt"), "Host ignored\n"));
+    QVERIFY(QDir(m_dir->path()).mkpath(QStringLiteral("conf.d/40-directory.conf")));
+
+    QStringList included;
+    const QVector<DiscoveredHost> hosts = discoverConfigHosts(m_configPath, &included);
+    // glob() sorts its matches, so the files are read in name order.
+    QCOMPARE(aliases(hosts), (QStringList{QStringLiteral("alpha"), QStringLiteral("bravo"), QStringLiteral("last")}));
+
+    QVERIFY(included.contains(m_dir->filePath(QStringLiteral("conf.d/10-alpha.conf"))));
+    QVERIFY(included.contains(m_dir->filePath(QStringLiteral("conf.d/20-bravo.conf"))));
+    QVERIFY(!included.contains(m_dir->filePath(QStringLiteral("conf.d/30-ignored.txt"))));
+    // The directories are watched for files that start matching later, even when nothing matches yet.
+    QVERIFY(included.contains(m_dir->filePath(QStringLiteral("conf.d"))));
+    QVERIFY(included.contains(m_dir->filePath(QStringLiteral("missing"))));
+}
+
+void SshConfigTest::resumesEnclosingBlock()
+{
+    QVERIFY(writeFile(QStringLiteral("config"),
+                      "Host outer\n"
+                      "    Include common.conf\n"
+                      "    HostName outer.example.com\n"
+                      "Host other\n"
+                      "    HostName other.example.com\n"));
+    QVERIFY(writeFile(QStringLiteral("common.conf"),
+                      "User deploy\n"
+                      "Port 2222\n"
+                      "Host inner\n"
+                      "    HostName inner.example.com\n"));
+
+    const QVector<DiscoveredHost> hosts = discoverConfigHosts(m_configPath);
+    QCOMPARE(aliases(hosts), (QStringList{QStringLiteral("outer"), QStringLiteral("inner"), QStringLiteral("other")}));
+
+    const DiscoveredHost *outer = findHost(hosts, QStringLiteral("outer"));
+    QVERIFY(outer);
+    QCOMPARE(outer->userName, QStringLiteral("deploy"));
+    QCOMPARE(outer->port, 2222);
+    // The Host line in the included file does not end the enclosing block.
+    QCOMPARE(outer->hostName, QStringLiteral("outer.example.com"));
+
+    const DiscoveredHost *inner = findHost(hosts, QStringLiteral("inner"));
+    QVERIFY(inner);
+    QCOMPARE(inner->hostName, QStringLiteral("inner.example.com"));
+    QVERIFY(inner->userName.isEmpty());
+    QCOMPARE(inner->port, -1);
+
+    const DiscoveredHost *other = findHost(hosts, QStringLiteral("other"));
+    QVERIFY(other);
+    QCOMPARE(other->hostName, QStringLiteral("other.example.com"));
+}
+
+void SshConfigTest::stopsAtIncludeCycles()
+{
+    // Every file includes the whole directory, itself among it. Walking each include path up to the
+    // depth limit would take 8^16 steps; ssh rejects the config at the first revisit instead.
+    QVERIFY(writeFile(QStringLiteral("config"), "Host before\nInclude loop/*.conf\nHost after\n"));
+    for (int i = 0; i < 8; ++i) {
+        QVERIFY(writeFile(QStringLiteral("loop/%1.conf").arg(i), "Host loop" + QByteArray::number(i) + "\nInclude loop/*.conf\n"));
+    }
+
+    const QVector<DiscoveredHost> hosts = discoverConfigHosts(m_configPath);
+    // Hosts read before the cycle was found are kept.
+    QCOMPARE(aliases(hosts), (QStringList{QStringLiteral("before"), QStringLiteral("loop0")}));
+
+    // A file included twice in a row is not a cycle.
+    QVERIFY(writeFile(QStringLiteral("config"), "Include shared.conf\nInclude shared.conf\nHost after\n"));
+    QVERIFY(writeFile(QStringLiteral("shared.conf"), "Host shared\n"));
+    QCOMPARE(aliases(discoverConfigHosts(m_configPath)), (QStringList{QStringLiteral("shared"), QStringLiteral("after")}));
+}
+
+QTEST_GUILESS_MAIN(SshConfigTest)
+
+#include "sshconfigtest.moc"
@@ -0,0 +1,274 @@
+#include "sshdns.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <atomic>
+#include <memory>
+
+using namespace SshHelper;
+
+namespace
+{
+// Answers from a fixed table instead of the network. Lookups can be held back to keep them in flight.
+class FakeDnsResolver : public DnsResolver
+{
+public:
+    explicit FakeDnsResolver(QHash<QString, QString> names)
+        : m_names(std::move(names))
+    {
+    }
+
+    QString reverseLookup(const QString &address) override
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_lookups.push_back(address);
+        }
+        if (m_holding) {
+            m_released.acquire();
+        }
+        return m_names.value(address);
+    }
+
+    void hold()
+    {
+        m_holding = true;
+    }
+
+    void release(int lookups)
+    {
+        m_released.release(lookups);
+    }
+
+    QStringList lookups()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_lookups;
+    }
+
+private:
+    const QHash<QString, QString> m_names;
+    QMutex m_mutex;
+    QStringList m_lookups;
+    QSemaphore m_released;
+    std::atomic<bool> m_holding = false;
+};
+
+struct CacheRecord {
+    QString address;
+    QString name;
+    qint64 timestamp = 0;
+};
+
+// Writes a dns_cache file the way DnsCache::save() does, with timestamps chosen by the test.
+bool writeCacheFile(const QString &path, const QList<CacheRecord> &records)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << quint32(0x53534844) << quint16(1) << quint32(records.size());
+    for (const CacheRecord &record : records) {
+        stream << record.address << record.name << record.timestamp;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+QHash<QString, QString> mergedResults(const QSignalSpy &spy)
+{
+    QHash<QString, QString> results;
+    for (const QList<QVariant> &arguments : spy) {
+        results.insert(arguments.at(0).value<QHash<QString, QString>>());
+    }
+    return results;
+}
+} // namespace
+
+class SshDnsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void reverseLookupAddress_data();
+    void reverseLookupAddress();
+    void cacheExpiresEntries();
+    void cacheMergesConcurrentWriters();
+    void resolvesThroughResolver();
+    void skipsAddressesInFlight();
+
+private:
+    std::unique_ptr<QTemporaryDir> m_dir;
+    QString m_cachePath;
+};
+
+void SshDnsTest::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    m_cachePath = m_dir->filePath(QStringLiteral("dns_cache"));
+}
+
+void SshDnsTest::reverseLookupAddress_data()
+{
+    QTest::addColumn<QString>("host");
+    QTest::addColumn<QString>("address");
+
+    QTest::newRow("ipv4") << QStringLiteral("10.0.0.1") << QStringLiteral("10.0.0.1");
+    QTest::newRow("user and ipv4") << QStringLiteral("root@10.0.0.1") << QStringLiteral("10.0.0.1");
+    QTest::newRow("ipv4 and port") << QStringLiteral("10.0.0.1:2222") << QStringLiteral("10.0.0.1");
+    QTest::newRow("bracketed ipv6 and port") << QStringLiteral("[fe80::1]:2222") << QStringLiteral("fe80::1");
+    QTest::newRow("scoped ipv6") << QStringLiteral("fe80::1%eth0") << QStringLiteral("fe80::1");
+    QTest::newRow("name") << QStringLiteral("web1.example.com") << QString();
+    QTest::newRow("empty") << QString() << QString();
+}
+
+void SshDnsTest::reverseLookupAddress()
+{
+    QFETCH(QString, host);
+    QFETCH(QString, address);
+
+    QCOMPARE(SshHelper::reverseLookupAddress(host), address);
+}
+
+void SshDnsTest::cacheExpiresEntries()
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QVERIFY(writeCacheFile(m_cachePath,
+                           {
+                               {QStringLiteral("10.0.0.1"), QStringLiteral("fresh.example.com"), now - 50},
+                               {QStringLiteral("10.0.0.2"), QStringLiteral("stale.example.com"), now - 200},
+                               {QStringLiteral("10.0.0.3"), QString(), now - 50},
+                               {QStringLiteral("10.0.0.4"), QString(), now - 20},
+                           }));
+
+    DnsCache cache(m_cachePath);
+    // Failed lookups get the shorter lifetime, as with the defaults.
+    cache.setTimeToLive(100, 30);
+    cache.load();
+
+    QString name;
+    QCOMPARE(cache.lookup(QStringLiteral("10.0.0.1"), &name), DnsCache::Status::Resolved);
+    QCOMPARE(name, QStringLiteral("fresh.example.com"));
+    QCOMPARE(cache.lookup(QStringLiteral("10.0.0.2"), &name), DnsCache::Status::Unknown);
+    QCOMPARE(cache.lookup(QStringLiteral("10.0.0.3"), &name), DnsCache::Status::Unknown);
+    QCOMPARE(cache.lookup(QStringLiteral("10.0.0.4"), &name), DnsCache::Status::Failed);
+    QCOMPARE(cache.lookup(QStringLiteral("10.0.0.5"), &name), DnsCache::Status::Unknown);
+
+    // Saving drops the expired entries from the file.
+    cache.insert(QStringLiteral("10.0.0.5"), QStringLiteral("new.example.com"));
+    QVERIFY(cache.save());
+    DnsCache reloaded(m_cachePath);
+    reloaded.setTimeToLive(1000, 1000);
+    reloaded.load();
+    QCOMPARE(reloaded.lookup(QStringLiteral("10.0.0.1"), &name), DnsCache::Status::Resolved);
+    QCOMPARE(reloaded.lookup(QStringLiteral("10.0.0.2"), &name), DnsCache::Status::Unknown);
+    QCOMPARE(reloaded.lookup(QStringLiteral("10.0.0.3"), &name), DnsCache::Status::Unknown);
+    QCOMPARE(reloaded.lookup(QStringLiteral("10.0.0.4"), &name), DnsCache::Status::Failed);
+    QCOMPARE(reloaded.lookup(QStringLiteral("10.0.0.5"), &name), DnsCache::Status::Resolved);
+    QCOMPARE(name, QStringLiteral("new.example.com"));
+}
+
+void SshDnsTest::cacheMergesConcurrentWriters()
+{
+    // The runner and the KCM each load the cache, resolve different hosts and save.
+    DnsCache runner(m_cachePath);
+    DnsCache kcm(m_cachePath);
+    runner.load();
+    kcm.load();
+    runner.insert(QStringLiteral("10.0.0.1"), QStringLiteral("one.example.com"));
+    kcm.insert(QStringLiteral("10.0.0.2"), QStringLiteral("two.example.com"));
+    QVERIFY(runner.save());
+    QVERIFY(kcm.save());
+
+    DnsCache merged(m_cachePath);
+    merged.load();
+    QString name;
+    QCOMPARE(merged.lookup(QStringLiteral("10.0.0.1"), &name), DnsCache::Status::Resolved);
+    QCOMPARE(name, QStringLiteral("one.example.com"));
+    QCOMPARE(merged.lookup(QStringLiteral("10.0.0.2"), &name), DnsCache::Status::Resolved);
+    QCOMPARE(name, QStringLiteral("two.example.com"));
+
+    // Of two results for one address the newer one wins, whichever side it is on.
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QVERIFY(writeCacheFile(m_cachePath,
+                           {
+                               {QStringLiteral("10.0.0.1"), QStringLiteral("older.example.com"), now - 60},
+                               {QStringLiteral("10.0.0.2"), QStringLiteral("newer.example.com"), now + 60},
+                           }));
+    DnsCache writer(m_cachePath);
+    writer.insert(QStringLiteral("10.0.0.1"), QStringLiteral("current.example.com"));
+    writer.insert(QStringLiteral("10.0.0.2"), QStringLiteral("current.example.com"));
+    QVERIFY(writer.save());
+    QCOMPARE(writer.lookup(QStringLiteral("10.0.0.1"), &name), DnsCache::Status::Resolved);
+    QCOMPARE(name, QStringLiteral("current.example.com"));
+    QCOMPARE(writer.lookup(QStringLiteral("10.0.0.2"), &name), DnsCache::Status::Resolved);
+    QCOMPARE(name, QStringLiteral("newer.example.com"));
+}
+
+void SshDnsTest::resolvesThroughResolver()
+{
+    auto fake = std::make_shared<FakeDnsResolver>(QHash<QString, QString>{
+        {QStringLiteral("10.0.0.1"), QStringLiteral("one.example.com")},
+        {QStringLiteral("10.0.0.2"), QStringLiteral("two.example.com")},
+    });
+    AsyncDnsResolver resolver(fake, 2);
+    QSignalSpy spy(&resolver, &AsyncDnsResolver::resultsReady);
+
+    resolver.resolve({QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.2"), QStringLiteral("10.0.0.3"), QString()});
+    // Results may arrive in one batch or several.
+    QTRY_COMPARE(mergedResults(spy).size(), 3);
+    const QHash<QString, QString> results = mergedResults(spy);
+    QCOMPARE(results.value(QStringLiteral("10.0.0.1")), QStringLiteral("one.example.com"));
+    QCOMPARE(results.value(QStringLiteral("10.0.0.2")), QStringLiteral("two.example.com"));
+    // A failed lookup is reported with an empty name, so it can be cached as failed.
+    QVERIFY(results.contains(QStringLiteral("10.0.0.3")));
+    QVERIFY(results.value(QStringLiteral("10.0.0.3")).isEmpty());
+    QCOMPARE(fake->lookups().size(), 3);
+
+    // Results feed the cache the way the runner stores them.
+    DnsCache cache(m_cachePath);
+    for (auto it = results.cbegin(); it != results.cend(); ++it) {
+        cache.insert(it.key(), it.value());
+    }
+    QString name;
+    QCOMPARE(cache.lookup(QStringLiteral("10.0.0.2"), &name), DnsCache::Status::Resolved);
+    QCOMPARE(name, QStringLiteral("two.example.com"));
+    QCOMPARE(cache.lookup(QStringLiteral("10.0.0.3"), &name), DnsCache::Status::Failed);
+}
+
+void SshDnsTest::skipsAddressesInFlight()
+{
+    auto fake = std::make_shared<FakeDnsResolver>(QHash<QString, QString>{{QStringLiteral("10.0.0.1"), QStringLiteral("one.example.com")}});
+    fake->hold();
+    AsyncDnsResolver resolver(fake, 4);
+    QSignalSpy spy(&resolver, &AsyncDnsResolver::resultsReady);
+
+    resolver.resolve({QStringLiteral("10.0.0.1")});
+    QTRY_COMPARE(fake->lookups().size(), 1);
+    // Asked again while the first lookup is still running: no second lookup.
+    resolver.resolve({QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.1")});
+    fake->release(1);
+    QVERIFY(spy.wait());
+    QCOMPARE(mergedResults(spy).value(QStringLiteral("10.0.0.1")), QStringLiteral("one.example.com"));
+    QCOMPARE(fake->lookups().size(), 1);
+
+    // Once finished, the address can be looked up again.
+    resolver.resolve({QStringLiteral("10.0.0.1")});
+    fake->release(1);
+    QTRY_COMPARE(fake->lookups().size(), 2);
+    QTRY_COMPARE(spy.count(), 2);
+}
+
+QTEST_GUILESS_MAIN(SshDnsTest)
+
+#include "sshdnstest.moc"
@@ -0,0 +1,514 @@
+#include "sshsearch.h"
+#include "sshsearch_p.h"
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include <algorithm>
+#include <numeric>
+
+using namespace SshHelper;
+
+namespace
+{
+qsizetype referenceFindByte(const QByteArray &text, char needle, qsizetype from)
+{
+    for (qsizetype i = from; i < text.size(); ++i) {
+        if (text.at(i) == needle) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Padded like SearchField::packed, so the vector kernels may load whole blocks past the end.
+QByteArray padded(const QByteArray &text)
+{
+    const qsizetype alignment = Detail::PackedAlignment;
+    QByteArray bytes = text;
+    bytes.resize(qMax(alignment, (text.size() + alignment - 1) / alignment * alignment), '\0');
+    return bytes;
+}
+
+QByteArray randomBytes(QRandomGenerator &random, qsizetype size, QByteArrayView alphabet)
+{
+    QByteArray bytes(size, Qt::Uninitialized);
+    for (char &c : bytes) {
+        c = alphabet.at(random.bounded(int(alphabet.size())));
+    }
+    return bytes;
+}
+
+// Plain O(nm) edit distance from pattern to the closest substring of text, the reference for approximateDistance().
+int referenceDistance(QStringView text, QStringView pattern)
+{
+    QVector<int> previous(text.size() + 1, 0);
+    QVector<int> current(text.size() + 1);
+    for (qsizetype i = 1; i <= pattern.size(); ++i) {
+        current[0] = int(i);
+        for (qsizetype j = 1; j <= text.size(); ++j) {
+            const int substitution = previous[j - 1] + (pattern.at(i - 1) == text.at(j - 1) ? 0 : 1);
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, substitution});
+        }
+        std::swap(previous, current);
+    }
+    return *std::min_element(previous.cbegin(), previous.cend());
+}
+
+QString randomText(QRandomGenerator &random, qsizetype size, QStringView alphabet)
+{
+    QString text(size, Qt::Uninitialized);
+    for (QChar &c : text) {
+        c = alphabet.at(random.bounded(int(alphabet.size())));
+    }
+    return text;
+}
+
+// fuzzyScore before the alignment tier: each token scored by where the greedy walk landed.
+// Kept as the baseline benchmarkScoring() measures the alignment against.
+double greedyScore(const SearchField &field, const SearchQuery &query, Detail::FindByteFunction findByte)
+{
+    const QStringView candidate(field.text);
+    const QStringView pattern(query.text);
+    if (candidate.isEmpty() || pattern.isEmpty()) {
+        return 0.0;
+    }
+    if (candidate == pattern) {
+        return 1.0;
+    }
+    const double proximity = static_cast<double>(pattern.size()) / static_cast<double>(candidate.size());
+    if (candidate.startsWith(pattern)) {
+        return qBound(0.0, 0.8 + (0.2 * proximity), 1.0);
+    }
+    if (candidate.contains(pattern)) {
+        return qBound(0.0, 0.6 + (0.2 * proximity), 1.0);
+    }
+
+    double total = 0.0;
+    for (const QByteArray &token : query.packedTokens) {
+        qsizetype first = -1;
+        qsizetype previous = -1;
+        int block = 0;
+        int bestBlock = 0;
+        bool found = true;
+        for (const char c : token) {
+            const qsizetype index = findByte(field.packed.constData(), candidate.size(), c, previous + 1);
+            if (index < 0) {
+                found = false;
+                break;
+            }
+            if (first < 0) {
+                first = index;
+            }
+            block = index == previous + 1 ? block + 1 : 1;
+            bestBlock = qMax(bestBlock, block);
+            previous = index;
+        }
+        if (!found) {
+            continue;
+        }
+        const double size = static_cast<double>(token.size());
+        const double span = static_cast<double>(qMax<qsizetype>(1, previous - first + 1));
+        const double weighted = 0.45 + (0.35 * bestBlock / size) + (0.20 * size / span) + (first == 0 ? 0.15 : 0.0);
+        total += qBound(0.0, weighted, 1.0);
+    }
+    return qBound(0.0, total / query.tokens.size(), 1.0);
+}
+
+// Host names shaped like a fleet's ssh config: "<environment>-<role><n>.<site>.example.com".
+QList<SearchField> hostCorpus(int count)
+{
+    static const char *const environments[] = {"prod", "stage", "dev", "qa"};
+    static const char *const roles[] = {"db", "web", "cache", "lb", "mail", "build"};
+    static const char *const sites[] = {"fra1", "ams2", "nyc3", "sfo1"};
+
+    QRandomGenerator random(15);
+    QList<SearchField> fields;
+    fields.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        fields.push_back(searchField(QStringLiteral("%1-%2%3.%4.example.com")
+                                         .arg(QLatin1String(environments[random.bounded(4)]), QLatin1String(roles[random.bounded(6)]))
+                                         .arg(random.bounded(100))
+                                         .arg(QLatin1String(sites[random.bounded(4)]))));
+    }
+    return fields;
+}
+
+QList<SearchQuery> benchmarkQueries()
+{
+    QList<SearchQuery> queries;
+    for (const char *text : {"dbp", "web1", "prdb", "stgc", "lbfra", "pdx9", "db fra"}) {
+        queries.push_back(compileSearchQuery(QString::fromLatin1(text)));
+    }
+    return queries;
+}
+
+template<typename Score>
+double scoreCorpus(const QList<SearchField> &fields, const QList<SearchQuery> &queries, Score score)
+{
+    double total = 0.0;
+    for (const SearchQuery &query : queries) {
+        for (const SearchField &field : fields) {
+            total += score(field, query);
+        }
+    }
+    return total;
+}
+} // namespace
+
+class SshSearchTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void findByteKernelsAgree_data();
+    void findByteKernelsAgree();
+    void packedScoringMatchesUtf16();
+    void parsesHostQueries_data();
+    void parsesHostQueries();
+    void ranking_data();
+    void ranking();
+    void ties_data();
+    void ties();
+    void refinedQueriesKeepMatches();
+    void approximateDistanceMatchesReference();
+    void benchmarkScoring_data();
+    void benchmarkScoring();
+    void benchmarkQueryLatency_data();
+    void benchmarkQueryLatency();
+};
+
+void SshSearchTest::findByteKernelsAgree_data()
+{
+    QTest::addColumn<QByteArray>("text");
+
+    // Sizes on both sides of the 16- and 32-byte blocks of the SSE2 and AVX2 kernels.
+    const QList<qsizetype> sizes{0, 1, 2, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 96, 127, 128, 129, 255, 256};
+    QRandomGenerator random(3);
+    for (const qsizetype size : sizes) {
+        QTest::addRow("random-%lld", qlonglong(size)) << randomBytes(random, size, "abcd-.");
+        QByteArray last(size, 'a');
+        if (size > 0) {
+            last[size - 1] = 'z';
+        }
+        QTest::addRow("last-%lld", qlonglong(size)) << last;
+    }
+}
+
+void SshSearchTest::findByteKernelsAgree()
+{
+    QFETCH(QByteArray, text);
+
+    const QByteArray bytes = padded(text);
+    const QByteArray needles = QByteArrayLiteral("abcdz-.x");
+    const QList<Detail::FindByteKernel> kernels = Detail::supportedFindByteKernels();
+    QVERIFY(!kernels.isEmpty());
+    for (const Detail::FindByteKernel &kernel : kernels) {
+        for (const char needle : needles) {
+            // Every start offset, up to and including the end of the field.
+            for (qsizetype from = 0; from <= text.size(); ++from) {
+                const qsizetype expected = referenceFindByte(text, needle, from);
+                const qsizetype found = kernel.function(bytes.constData(), text.size(), needle, from);
+                if (found != expected) {
+                    QFAIL(qPrintable(QStringLiteral("%1: '%2' from %3 found %4, expected %5")
+                                         .arg(QLatin1String(kernel.name))
+                                         .arg(QLatin1Char(needle))
+                                         .arg(from)
+                                         .arg(found)
+                                         .arg(expected)));
+                }
+            }
+        }
+    }
+}
+
+void SshSearchTest::packedScoringMatchesUtf16()
+{
+    QRandomGenerator random(7);
+    for (int i = 0; i < 2000; ++i) {
+        const SearchField field = searchField(QString::fromLatin1(randomBytes(random, random.bounded(1, 80), "abcdeXY-._ 01")));
+        SearchField unpacked = field;
+        unpacked.packed.clear();
+        const SearchQuery query = compileSearchQuery(QString::fromLatin1(randomBytes(random, random.bounded(1, 6), "abcde-0 ")));
+        QCOMPARE(fuzzyScore(field, query), fuzzyScore(unpacked, query));
+    }
+}
+
+void SshSearchTest::parsesHostQueries_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("searchText");
+    QTest::addColumn<QString>("fullText");
+    QTest::addColumn<QString>("user");
+    QTest::addColumn<int>("port");
+    // -1 for no origin filter.
+    QTest::addColumn<int>("origin");
+    QTest::addColumn<QString>("userFilter");
+
+    const QString none;
+    QTest::newRow("host") << QStringLiteral("web1") << QStringLiteral("web1") << QStringLiteral("web1") << none << -1 << -1 << none;
+    QTest::newRow("user") << QStringLiteral("root@web1") << QStringLiteral("web1") << QStringLiteral("root@web1") << QStringLiteral("root") << -1 << -1
+                          << none;
+    QTest::newRow("port") << QStringLiteral("web1:2222") << QStringLiteral("web1") << QStringLiteral("web1") << none << 2222 << -1 << none;
+    QTest::newRow("user and port") << QStringLiteral("root@web1:2222") << QStringLiteral("web1") << QStringLiteral("root@web1") << QStringLiteral("root")
+                                   << 2222 << -1 << none;
+    QTest::newRow("port out of range") << QStringLiteral("web1:70000") << QStringLiteral("web1:70000") << QStringLiteral("web1:70000") << none << -1
+                                       << -1 << none;
+    QTest::newRow("trailing colon") << QStringLiteral("web1:") << QStringLiteral("web1:") << QStringLiteral("web1:") << none << -1 << -1 << none;
+    QTest::newRow("bare ipv6") << QStringLiteral("fe80::1") << QStringLiteral("fe80::1") << QStringLiteral("fe80::1") << none << -1 << -1 << none;
+    QTest::newRow("bracketed ipv6") << QStringLiteral("[::1]") << QStringLiteral("::1") << QStringLiteral("::1") << none << -1 << -1 << none;
+    QTest::newRow("ipv6 and port") << QStringLiteral("[::1]:22") << QStringLiteral("::1") << QStringLiteral("::1") << none << 22 << -1 << none;
+    QTest::newRow("user, ipv6 and port") << QStringLiteral("admin@[fe80::1]:2222") << QStringLiteral("fe80::1") << QStringLiteral("admin@fe80::1")
+                                         << QStringLiteral("admin") << 2222 << -1 << none;
+    QTest::newRow("empty brackets") << QStringLiteral("[]") << QStringLiteral("[]") << QStringLiteral("[]") << none << -1 << -1 << none;
+    QTest::newRow("origin filter") << QStringLiteral("origin:known_hosts db") << QStringLiteral("db") << QStringLiteral("db") << none << -1
+                                   << int(EntryOrigin::KnownHosts) << none;
+    QTest::newRow("user filter") << QStringLiteral("db user:deploy") << QStringLiteral("db") << QStringLiteral("db") << none << -1 << -1
+                                 << QStringLiteral("deploy");
+    QTest::newRow("unknown origin") << QStringLiteral("origin:elsewhere") << QStringLiteral("origin:elsewhere") << QStringLiteral("origin:elsewhere")
+                                    << none << -1 << -1 << none;
+    QTest::newRow("filters only") << QStringLiteral("origin:manual") << none << none << none << -1 << int(EntryOrigin::Manual) << none;
+    QTest::newRow("several words") << QStringLiteral("db  fra") << QStringLiteral("db fra") << QStringLiteral("db fra") << none << -1 << -1 << none;
+}
+
+void SshSearchTest::parsesHostQueries()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, searchText);
+    QFETCH(QString, fullText);
+    QFETCH(QString, user);
+    QFETCH(int, port);
+    QFETCH(int, origin);
+    QFETCH(QString, userFilter);
+
+    const HostQuery query = parseHostQuery(text);
+    QCOMPARE(query.searchText, searchText);
+    QCOMPARE(query.fullText, fullText);
+    QCOMPARE(query.user, user);
+    QCOMPARE(query.port, port);
+    QCOMPARE(query.origin.has_value() ? int(*query.origin) : -1, origin);
+    QCOMPARE(query.userFilter, userFilter);
+}
+
+void SshSearchTest::ranking_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("better");
+    QTest::addColumn<QString>("worse");
+
+    // Tiers: exact, then prefix, then substring, then subsequence, whatever the alignment bonuses.
+    QTest::newRow("exact over prefix") << QStringLiteral("web") << QStringLiteral("web") << QStringLiteral("webserver");
+    QTest::newRow("prefix over substring") << QStringLiteral("web") << QStringLiteral("webserver") << QStringLiteral("myweb");
+    QTest::newRow("long prefix over substring") << QStringLiteral("web") << QStringLiteral("webserver-with-a-long-name.example.com")
+                                                << QStringLiteral("myweb");
+    QTest::newRow("substring over subsequence") << QStringLiteral("web") << QStringLiteral("myweb") << QStringLiteral("wxexb");
+    QTest::newRow("substring over boundary subsequence") << QStringLiteral("ab") << QStringLiteral("xab") << QStringLiteral("a b");
+    QTest::newRow("prefix over boundary subsequence") << QStringLiteral("ab") << QStringLiteral("abxxxxxxxxxxxxxxxx") << QStringLiteral("a b");
+    QTest::newRow("substring over word starts") << QStringLiteral("web") << QStringLiteral("xweb") << QStringLiteral("w e b");
+
+    // Within the subsequence tier: where the characters land.
+    QTest::newRow("delimiter over gap") << QStringLiteral("dbp") << QStringLiteral("db-prod") << QStringLiteral("dbxpxx");
+    QTest::newRow("first character") << QStringLiteral("dp") << QStringLiteral("db-prod") << QStringLiteral("adbxp");
+    QTest::newRow("word start") << QStringLiteral("sb") << QStringLiteral("staging box") << QStringLiteral("xstab");
+    QTest::newRow("camelCase") << QStringLiteral("gs") << QStringLiteral("gitServer") << QStringLiteral("gastro");
+    QTest::newRow("camelCase over mid-word") << QStringLiteral("fs") << QStringLiteral("fooSync") << QStringLiteral("foosync");
+    QTest::newRow("whitespace over delimiter") << QStringLiteral("fs") << QStringLiteral("foo sync") << QStringLiteral("foo-sync");
+    QTest::newRow("delimiter over other punctuation") << QStringLiteral("fs") << QStringLiteral("foo-sync") << QStringLiteral("foo+sync");
+    QTest::newRow("punctuation over mid-word") << QStringLiteral("fs") << QStringLiteral("foo+sync") << QStringLiteral("foosync");
+    QTest::newRow("dot delimiter") << QStringLiteral("pd") << QStringLiteral("prod.db") << QStringLiteral("prodxdb");
+    QTest::newRow("dash delimiter") << QStringLiteral("pd") << QStringLiteral("prod-db") << QStringLiteral("prodxdb");
+    QTest::newRow("digit after delimiter") << QStringLiteral("h1") << QStringLiteral("host-1") << QStringLiteral("hostx1");
+    QTest::newRow("digit after letters") << QStringLiteral("h1") << QStringLiteral("host1") << QStringLiteral("hxostx1");
+    QTest::newRow("short gap over long gap") << QStringLiteral("ac") << QStringLiteral("abc") << QStringLiteral("abbbbbc");
+    QTest::newRow("boundaries over long gap") << QStringLiteral("db") << QStringLiteral("d-b") << QStringLiteral("dxxxxxxxxxb");
+    QTest::newRow("run over split") << QStringLiteral("dbp") << QStringLiteral("db-prod") << QStringLiteral("d-b-prod");
+    QTest::newRow("host segments") << QStringLiteral("dbfr") << QStringLiteral("db.fra1") << QStringLiteral("dxbxfxr");
+    QTest::newRow("several tokens") << QStringLiteral("db fra") << QStringLiteral("db.fra1.example.com") << QStringLiteral("dxb.fxra");
+    QTest::newRow("any match over none") << QStringLiteral("pro") << QStringLiteral("p") + QString(50, QLatin1Char('x')) + QStringLiteral("ro")
+                                         << QStringLiteral("orp");
+}
+
+void SshSearchTest::ranking()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, better);
+    QFETCH(QString, worse);
+
+    const SearchQuery compiled = compileSearchQuery(query);
+    const double betterScore = fuzzyScore(searchField(better), compiled);
+    const double worseScore = fuzzyScore(searchField(worse), compiled);
+    QVERIFY2(betterScore > worseScore, qPrintable(QStringLiteral("%1 scored %2, %3 scored %4").arg(better).arg(betterScore).arg(worse).arg(worseScore)));
+}
+
+void SshSearchTest::ties_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QString>("first");
+    QTest::addColumn<QString>("second");
+
+    QTest::newRow("prefix") << QStringLiteral("web") << QStringLiteral("web1.example.com") << QStringLiteral("web2.example.com");
+    QTest::newRow("substring") << QStringLiteral("db") << QStringLiteral("xdbx") << QStringLiteral("ydby");
+    QTest::newRow("substring after delimiter") << QStringLiteral("fr") << QStringLiteral("x-fra1") << QStringLiteral("y-fra2");
+    QTest::newRow("case") << QStringLiteral("fs") << QStringLiteral("FooSync") << QStringLiteral("fooSync");
+    QTest::newRow("whitespace") << QStringLiteral("dp") << QStringLiteral("db prod") << QStringLiteral("  db   prod ");
+}
+
+// Equal scores leave the order to the runner, which keeps the display order.
+void SshSearchTest::ties()
+{
+    QFETCH(QString, query);
+    QFETCH(QString, first);
+    QFETCH(QString, second);
+
+    const SearchQuery compiled = compileSearchQuery(query);
+    QCOMPARE(fuzzyScore(searchField(first), compiled), fuzzyScore(searchField(second), compiled));
+}
+
+void SshSearchTest::refinedQueriesKeepMatches()
+{
+    // The runner only rescores the previous survivors when a query grows within its last token.
+    const SearchField gapped = searchField(QStringLiteral("p") + QString(50, QLatin1Char('x')) + QStringLiteral("ro"));
+    QVERIFY(fuzzyScore(gapped, compileSearchQuery(QStringLiteral("pr"))) > 0.0);
+    QVERIFY(fuzzyScore(gapped, compileSearchQuery(QStringLiteral("pro"))) > 0.0);
+
+    QRandomGenerator random(4);
+    for (int i = 0; i < 2000; ++i) {
+        const SearchField field = searchField(QString::fromLatin1(randomBytes(random, random.bounded(1, 120), "abcdex-. ")));
+        const QString query = QString::fromLatin1(randomBytes(random, random.bounded(2, 8), "abcde-"));
+        for (qsizetype size = 1; size < query.size(); ++size) {
+            if (fuzzyScore(field, compileSearchQuery(query.first(size + 1))) > 0.0) {
+                QVERIFY2(fuzzyScore(field, compileSearchQuery(query.first(size))) > 0.0,
+                         qPrintable(QStringLiteral("\"%1\" matches %2, its prefix does not").arg(query.first(size + 1), field.text)));
+            }
+        }
+    }
+}
+
+void SshSearchTest::approximateDistanceMatchesReference()
+{
+    // A small alphabet so random pairs land within a couple of edits; the non-ASCII letter goes through the hashed masks.
+    const QString alphabet = QStringLiteral("abc-\u00e9");
+    QRandomGenerator random(17);
+    for (int i = 0; i < 3000; ++i) {
+        const QString text = randomText(random, random.bounded(1, 120), alphabet);
+        QString pattern;
+        if (i % 2 == 0) {
+            pattern = randomText(random, random.bounded(1, 65), alphabet);
+        } else {
+            // A substring of the text with up to two random edits, so close matches are common too.
+            const qsizetype start = random.bounded(int(text.size()));
+            pattern = text.mid(start, random.bounded(1, 65));
+            for (int edit = random.bounded(3); edit > 0; --edit) {
+                const qsizetype at = random.bounded(int(pattern.size()));
+                switch (random.bounded(3)) {
+                case 0:
+                    pattern[at] = alphabet.at(random.bounded(int(alphabet.size())));
+                    break;
+                case 1:
+                    pattern.insert(at, alphabet.at(random.bounded(int(alphabet.size()))));
+                    break;
+                default:
+                    if (pattern.size() > 1) {
+                        pattern.remove(at, 1);
+                    }
+                    break;
+                }
+            }
+            pattern.truncate(64);
+        }
+
+        const SearchField field = searchField(text);
+        QCOMPARE(field.text, text);
+        const ApproximatePattern compiled = compileApproximatePattern(pattern);
+        QCOMPARE(compiled.size, int(pattern.size()));
+        const int reference = referenceDistance(text, pattern);
+        for (int maxDistance = 0; maxDistance <= 2; ++maxDistance) {
+            const int expected = reference <= maxDistance ? reference : -1;
+            const int distance = approximateDistance(field, compiled, maxDistance);
+            if (distance != expected) {
+                QFAIL(qPrintable(QStringLiteral("\"%1\" in \"%2\" within %3: %4, expected %5").arg(pattern, text).arg(maxDistance).arg(distance).arg(expected)));
+            }
+        }
+    }
+}
+
+// The alignment tier is budgeted at twice the greedy cost; compare the two rows. Not asserted,
+// timings on shared CI machines are too noisy for that.
+void SshSearchTest::benchmarkScoring_data()
+{
+    QTest::addColumn<bool>("alignment");
+
+    QTest::newRow("greedy") << false;
+    QTest::newRow("alignment") << true;
+}
+
+void SshSearchTest::benchmarkScoring()
+{
+    QFETCH(bool, alignment);
+
+    const QList<SearchField> fields = hostCorpus(20000);
+    const QList<SearchQuery> queries = benchmarkQueries();
+    const Detail::FindByteFunction findByte = Detail::supportedFindByteKernels().constLast().function;
+    double total = 0.0;
+    QBENCHMARK {
+        if (alignment) {
+            total += scoreCorpus(fields, queries, fuzzyScore);
+        } else {
+            total += scoreCorpus(fields, queries, [findByte](const SearchField &field, const SearchQuery &query) {
+                return greedyScore(field, query, findByte);
+            });
+        }
+    }
+    QVERIFY(total > 0.0);
+}
+
+void SshSearchTest::benchmarkQueryLatency_data()
+{
+    QTest::addColumn<int>("targets");
+    QTest::addColumn<bool>("indexed");
+
+    for (const int targets : {1000, 10000, 100000}) {
+        QTest::addRow("%d-scan", targets) << targets << false;
+        QTest::addRow("%d-index", targets) << targets << true;
+    }
+}
+
+// One keystroke as the runner handles it: prune through the posting index, then score the survivors.
+void SshSearchTest::benchmarkQueryLatency()
+{
+    QFETCH(int, targets);
+    QFETCH(bool, indexed);
+
+    const QList<SearchField> labels = hostCorpus(targets);
+    QList<SearchFields> rows;
+    rows.reserve(targets);
+    SearchIndex index;
+    for (int slot = 0; slot < targets; ++slot) {
+        SearchFields fields;
+        fields.label = labels.at(slot);
+        fields.arguments = labels.at(slot);
+        index.addEntry(slot, fields);
+        rows.push_back(fields);
+    }
+    const SearchQuery query = compileSearchQuery(QStringLiteral("dbfra"));
+
+    QVector<int> candidates;
+    int matches = 0;
+    QBENCHMARK {
+        if (!indexed || !index.collectCandidates({&query}, candidates)) {
+            candidates.resize(targets);
+            std::iota(candidates.begin(), candidates.end(), 0);
+        }
+        matches = 0;
+        for (const int slot : std::as_const(candidates)) {
+            if (qMax(fuzzyScore(rows.at(slot).label, query), fuzzyScore(rows.at(slot).arguments, query)) > 0.0) {
+                ++matches;
+            }
+        }
+    }
+    QVERIFY(matches > 0);
+}
+
+QTEST_GUILESS_MAIN(SshSearchTest)
+
+#include "sshsearchtest.moc"
@@ -0,0 +1,195 @@
+#include "sshsnapshot.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace SshHelper;
+
+namespace
+{
+SshTarget makeTarget(const QString &host, int hostArgument = 0)
+{
+    SshTarget target;
+    target.id = entryIdForArguments({host});
+    target.defaultLabel = host;
+    target.label = host;
+    target.description = QStringLiteral("known_hosts entry");
+    target.sshArguments = {host};
+    target.hostName = host;
+    target.userName = QStringLiteral("deploy");
+    target.origin = EntryOrigin::KnownHosts;
+    target.hostArgument = hostArgument;
+    target.search.label = searchField(target.label);
+    target.search.arguments = searchField(host);
+    target.search.description = searchField(target.description);
+    target.search.userName = searchField(target.userName);
+    target.search.userHost = searchField(target.userName + QLatin1Char('@') + host);
+    return target;
+}
+
+void addTarget(HostSnapshot &snapshot, const SshTarget &target)
+{
+    const int slot = snapshot.targets.append(target);
+    snapshot.slotById.insert(target.id, slot);
+    snapshot.searchIndex.addEntry(slot, target.search);
+    snapshot.order.push_back(slot);
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+} // namespace
+
+class SshSnapshotTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void roundTrips();
+    void rejectsStaleSources();
+    void rejectsTruncatedFiles();
+    void clampsHostArgument_data();
+    void clampsHostArgument();
+
+private:
+    // A snapshot of m_sources, written to m_snapshotPath.
+    HostSnapshot makeSnapshot() const;
+
+    QTemporaryDir m_dir;
+    QStringList m_sources;
+    QString m_include;
+    QString m_snapshotPath;
+};
+
+void SshSnapshotTest::init()
+{
+    QVERIFY(m_dir.isValid());
+    m_sources = {m_dir.filePath(QStringLiteral("config")), m_dir.filePath(QStringLiteral("known_hosts"))};
+    m_include = m_dir.filePath(QStringLiteral("config.d"));
+    m_snapshotPath = m_dir.filePath(QStringLiteral("hosts_snapshot"));
+    QVERIFY(writeFile(m_sources.at(0), "Include config.d\n"));
+    QVERIFY(writeFile(m_sources.at(1), "alpha.example.com ssh-ed25519 AAAA\n"));
+    QVERIFY(writeFile(m_include, "Host bravo\n"));
+}
+
+HostSnapshot SshSnapshotTest::makeSnapshot() const
+{
+    HostSnapshot snapshot;
+    snapshot.terminal = {QStringLiteral("custom"), QStringLiteral("xterm -e")};
+    snapshot.maxResults = 7;
+    snapshot.configIncludes = {m_include};
+    snapshot.sourceKey = sourceStampKey(m_sources) + fileStamps(snapshot.configIncludes);
+    addTarget(snapshot, makeTarget(QStringLiteral("charlie.example.com")));
+    addTarget(snapshot, makeTarget(QStringLiteral("alpha.example.com")));
+    addTarget(snapshot, makeTarget(QStringLiteral("bravo")));
+    snapshot.order = {1, 2, 0};
+    updateRanks(snapshot);
+    return snapshot;
+}
+
+void SshSnapshotTest::roundTrips()
+{
+    const HostSnapshot written = makeSnapshot();
+    QCOMPARE(written.rankBySlot, (QVector<int>{2, 0, 1}));
+    QVERIFY(writeSnapshotFile(m_snapshotPath, written));
+
+    const std::shared_ptr<HostSnapshot> read = readSnapshotFile(m_snapshotPath, m_sources);
+    QVERIFY(read);
+    QCOMPARE(read->sourceKey, written.sourceKey);
+    QCOMPARE(read->configIncludes, written.configIncludes);
+    QCOMPARE(read->terminal.id, written.terminal.id);
+    QCOMPARE(read->terminal.customCommand, written.terminal.customCommand);
+    QCOMPARE(read->maxResults, written.maxResults);
+    QCOMPARE(read->order, written.order);
+    QCOMPARE(read->rankBySlot, written.rankBySlot);
+    QCOMPARE(read->slotById, written.slotById);
+    QCOMPARE(read->searchIndex.size(), written.searchIndex.size());
+    QVERIFY(read->sortKeys.empty());
+    QCOMPARE(read->targets.size(), written.targets.size());
+    for (int slot = 0; slot < written.targets.size(); ++slot) {
+        const SshTarget expected = written.targets.at(slot);
+        const SshTarget actual = read->targets.at(slot);
+        QCOMPARE(actual.id, expected.id);
+        QCOMPARE(actual.label, expected.label);
+        QCOMPARE(actual.defaultLabel, expected.defaultLabel);
+        QCOMPARE(actual.description, expected.description);
+        QCOMPARE(actual.sshArguments, expected.sshArguments);
+        QCOMPARE(actual.hostName, expected.hostName);
+        QCOMPARE(actual.userName, expected.userName);
+        QCOMPARE(actual.origin, expected.origin);
+        QCOMPARE(actual.isManual, expected.isManual);
+        QCOMPARE(actual.hostArgument, expected.hostArgument);
+        QCOMPARE(actual.search.userHost.text, expected.search.userHost.text);
+        QCOMPARE(actual.search.userHost.bonus, expected.search.userHost.bonus);
+    }
+}
+
+void SshSnapshotTest::rejectsStaleSources()
+{
+    QVERIFY(writeSnapshotFile(m_snapshotPath, makeSnapshot()));
+    QVERIFY(readSnapshotFile(m_snapshotPath, m_sources));
+
+    // A different set of sources does not match the recorded stamps either.
+    QVERIFY(!readSnapshotFile(m_snapshotPath, {m_sources.at(0)}));
+
+    QVERIFY(writeFile(m_sources.at(1), "alpha.example.com ssh-ed25519 AAAA\nbravo ssh-ed25519 AAAA\n"));
+    QVERIFY(!readSnapshotFile(m_snapshotPath, m_sources));
+
+    // The included files are stamped as well.
+    QVERIFY(writeSnapshotFile(m_snapshotPath, makeSnapshot()));
+    QVERIFY(readSnapshotFile(m_snapshotPath, m_sources));
+    QVERIFY(writeFile(m_include, "Host bravo charlie\n"));
+    QVERIFY(!readSnapshotFile(m_snapshotPath, m_sources));
+
+    QVERIFY(QFile::remove(m_include));
+    QVERIFY(!readSnapshotFile(m_snapshotPath, m_sources));
+}
+
+void SshSnapshotTest::rejectsTruncatedFiles()
+{
+    QVERIFY(writeSnapshotFile(m_snapshotPath, makeSnapshot()));
+    QFile file(m_snapshotPath);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    file.close();
+
+    for (const qsizetype size : {qsizetype(0), qsizetype(4), data.size() / 2, data.size() - 1}) {
+        QVERIFY(writeFile(m_snapshotPath, data.first(size)));
+        QVERIFY2(!readSnapshotFile(m_snapshotPath, m_sources), qPrintable(QStringLiteral("%1 of %2 bytes").arg(size).arg(data.size())));
+    }
+}
+
+void SshSnapshotTest::clampsHostArgument_data()
+{
+    QTest::addColumn<int>("written");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("valid") << 0 << 0;
+    QTest::newRow("none") << -1 << -1;
+    QTest::newRow("past the end") << 1 << -1;
+    QTest::newRow("negative") << -7 << -1;
+}
+
+void SshSnapshotTest::clampsHostArgument()
+{
+    QFETCH(int, written);
+    QFETCH(int, expected);
+
+    HostSnapshot snapshot = makeSnapshot();
+    SshTarget target = snapshot.targets.at(0);
+    target.hostArgument = written;
+    snapshot.targets.replace(0, target);
+    QVERIFY(writeSnapshotFile(m_snapshotPath, snapshot));
+
+    const std::shared_ptr<HostSnapshot> read = readSnapshotFile(m_snapshotPath, m_sources);
+    QVERIFY(read);
+    QCOMPARE(read->targets.hostArgument(0), expected);
+}
+
+QTEST_GUILESS_MAIN(SshSnapshotTest)
+
+#include "sshsnapshottest.moc"
@@ -0,0 +1,271 @@
+#include "sshtargets.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QTest>
+
+#include <unistd.h>
+
+using namespace SshHelper;
+
+namespace
+{
+constexpr int s_hosts = 100000;
+
+// Shaped like a known_hosts target after SshHelperRunner::finalizeTarget(); round changes every string.
+SshTarget makeTarget(int index, int round)
+{
+    SshTarget target;
+    const QString host = QStringLiteral("host%1-%2.fra1.example.com").arg(index).arg(round);
+    target.id = QString::fromLatin1(QCryptographicHash::hash(host.toUtf8(), QCryptographicHash::Sha1).toHex());
+    target.defaultLabel = host;
+    target.label = host;
+    target.description = QStringLiteral("known_hosts entry");
+    target.sshArguments = {host};
+    target.hostName = host;
+    target.userName = QStringLiteral("deploy");
+    target.origin = EntryOrigin::KnownHosts;
+    target.hostArgument = 0;
+    target.search.label = searchField(target.label);
+    target.search.arguments = searchField(host);
+    target.search.description = searchField(target.description);
+    target.search.userName = searchField(target.userName);
+    target.search.userHost = searchField(target.userName + QLatin1Char('@') + host);
+    return target;
+}
+
+TargetTable makeTable(int round, int count = s_hosts)
+{
+    TargetTable table;
+    table.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        table.append(makeTarget(i, round));
+    }
+    return table;
+}
+
+// The layout TargetTable replaced: whole targets, every search field owning its own allocations.
+QVector<SshTarget> makeTargets(int round, int count = s_hosts)
+{
+    QVector<SshTarget> targets;
+    targets.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        targets.push_back(makeTarget(i, round));
+    }
+    return targets;
+}
+
+// Scores every field the way SshHelperRunner::match() does and counts the hits.
+template<typename Fields>
+int countMatches(int size, const SearchQuery &query, Fields fields)
+{
+    int matches = 0;
+    for (int slot = 0; slot < size; ++slot) {
+        double relevance = 0.0;
+        for (int field = 0; field < TargetTable::FieldCount; ++field) {
+            relevance = qMax(relevance, fuzzyScore(fields(slot, TargetTable::Field(field)), query));
+        }
+        if (relevance > 0.0) {
+            ++matches;
+        }
+    }
+    return matches;
+}
+
+SearchFieldView baselineField(const SearchFields &search, TargetTable::Field field)
+{
+    switch (field) {
+    case TargetTable::LabelField:
+        return search.label;
+    case TargetTable::ArgumentsField:
+        return search.arguments;
+    case TargetTable::DescriptionField:
+        return search.description;
+    case TargetTable::DefaultLabelField:
+        return search.defaultLabel;
+    case TargetTable::DnsNameField:
+        return search.dnsName;
+    case TargetTable::UserNameField:
+        return search.userName;
+    case TargetTable::UserHostField:
+    case TargetTable::FieldCount:
+        break;
+    }
+    return search.userHost;
+}
+
+void compareFields(const SearchFields &actual, const SearchFields &expected)
+{
+    for (int field = 0; field < TargetTable::FieldCount; ++field) {
+        const SearchFieldView lhs = baselineField(actual, TargetTable::Field(field));
+        const SearchFieldView rhs = baselineField(expected, TargetTable::Field(field));
+        QCOMPARE(lhs.text.toString(), rhs.text.toString());
+        QCOMPARE(QByteArray(reinterpret_cast<const char *>(lhs.bonus), lhs.text.size()), QByteArray(reinterpret_cast<const char *>(rhs.bonus), rhs.text.size()));
+        QCOMPARE(lhs.packed == nullptr, rhs.packed == nullptr);
+    }
+}
+
+// Resident set size from /proc/self/statm, or -1 where that does not exist.
+qint64 residentBytes()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) : -1;
+}
+} // namespace
+
+class SshTargetsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void replaceKeepsRows();
+    void fieldsRoundTrip();
+    void compactionKeepsFields();
+    void reportResidentSize();
+    void benchmarkAssemble();
+    void benchmarkPatchCopy();
+    void benchmarkScan_data();
+    void benchmarkScan();
+};
+
+void SshTargetsTest::replaceKeepsRows()
+{
+    TargetTable table;
+    QCOMPARE(table.append(makeTarget(0, 0)), 0);
+    QCOMPARE(table.append(makeTarget(1, 0)), 1);
+
+    const TargetTable before = table;
+    table.replace(0, makeTarget(0, 1));
+    QCOMPARE(table.size(), 2);
+    QCOMPARE(table.label(0), QStringLiteral("host0-1.fra1.example.com"));
+    QCOMPARE(table.field(0, TargetTable::LabelField).text.toString(), QStringLiteral("host0-1.fra1.example.com"));
+    QCOMPARE(table.label(1), QStringLiteral("host1-0.fra1.example.com"));
+    // Snapshots copy the table before patching it; the copy must not see the patch.
+    QCOMPARE(before.label(0), QStringLiteral("host0-0.fra1.example.com"));
+    QCOMPARE(before.field(0, TargetTable::LabelField).text.toString(), QStringLiteral("host0-0.fra1.example.com"));
+    QCOMPARE(table.at(1).sshArguments, before.at(1).sshArguments);
+}
+
+void SshTargetsTest::fieldsRoundTrip()
+{
+    SshTarget target = makeTarget(7, 0);
+    // No packed copy for non-ASCII text, and a snapshot file whose packed copy lost its padding.
+    target.search.description = searchField(QStringLiteral("Server in Zürich"));
+    target.search.dnsName = searchField(QStringLiteral("host7.example.com"));
+    target.search.dnsName.packed.truncate(target.search.dnsName.text.size());
+
+    TargetTable table;
+    table.append(target);
+    compareFields(table.searchFields(0), target.search);
+    QVERIFY(!table.field(0, TargetTable::DescriptionField).packed);
+
+    const SearchQuery query = compileSearchQuery(QStringLiteral("h7ex"));
+    for (int field = 0; field < TargetTable::FieldCount; ++field) {
+        const auto kind = TargetTable::Field(field);
+        QCOMPARE(fuzzyScore(table.field(0, kind), query), fuzzyScore(baselineField(target.search, kind), query));
+    }
+}
+
+void SshTargetsTest::compactionKeepsFields()
+{
+    constexpr int count = 2000;
+    TargetTable table = makeTable(0, count);
+    // Enough rewrites that the arena is compacted several times over.
+    for (int round = 1; round <= 4; ++round) {
+        for (int i = 0; i < count; ++i) {
+            table.replace(i, makeTarget(i, round));
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        compareFields(table.searchFields(i), makeTarget(i, 4).search);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+    }
+}
+
+void SshTargetsTest::reportResidentSize()
+{
+    const qint64 empty = residentBytes();
+    if (empty < 0) {
+        QSKIP("No /proc/self/statm to read the resident set size from");
+    }
+    // Only reported: what the allocator keeps resident is not something to assert on.
+    TargetTable table = makeTable(0);
+    const qint64 withTable = residentBytes();
+    qInfo("TargetTable, %d hosts: %lld bytes resident, %lld per host", s_hosts, withTable - empty, (withTable - empty) / s_hosts);
+    const QVector<SshTarget> targets = makeTargets(0);
+    const qint64 withTargets = residentBytes();
+    qInfo("QVector<SshTarget>, %d hosts: %lld bytes resident, %lld per host", s_hosts, withTargets - withTable, (withTargets - withTable) / s_hosts);
+
+    for (int round = 1; round <= 3; ++round) {
+        for (int i = 0; i < s_hosts; ++i) {
+            table.replace(i, makeTarget(i, round));
+        }
+    }
+    qInfo("after rewriting the table three times: %lld bytes resident", residentBytes() - empty);
+}
+
+void SshTargetsTest::benchmarkAssemble()
+{
+    const QVector<SshTarget> targets = makeTargets(0);
+    QBENCHMARK {
+        TargetTable table;
+        table.reserve(s_hosts);
+        for (const SshTarget &target : targets) {
+            table.append(target);
+        }
+    }
+}
+
+// What patchSettings() does per reload: copy the published table and rewrite one row.
+void SshTargetsTest::benchmarkPatchCopy()
+{
+    const TargetTable table = makeTable(0);
+    const SshTarget patched = makeTarget(s_hosts / 2, 1);
+    QBENCHMARK {
+        TargetTable copy = table;
+        copy.replace(s_hosts / 2, patched);
+    }
+}
+
+void SshTargetsTest::benchmarkScan_data()
+{
+    QTest::addColumn<bool>("table");
+
+    QTest::newRow("QVector<SshTarget>") << false;
+    QTest::newRow("TargetTable") << true;
+}
+
+// The per-keystroke walk over every search field, on the table and on the layout it replaced.
+void SshTargetsTest::benchmarkScan()
+{
+    QFETCH(bool, table);
+
+    const SearchQuery query = compileSearchQuery(QStringLiteral("h12fra"));
+    int matches = 0;
+    if (table) {
+        const TargetTable targets = makeTable(0);
+        QBENCHMARK {
+            matches = countMatches(targets.size(), query, [&targets](int slot, TargetTable::Field field) {
+                return targets.field(slot, field);
+            });
+        }
+    } else {
+        const QVector<SshTarget> targets = makeTargets(0);
+        QBENCHMARK {
+            matches = countMatches(int(targets.size()), query, [&targets](int slot, TargetTable::Field field) {
+                return baselineField(targets.at(slot).search, field);
+            });
+        }
+    }
+    QVERIFY(matches > 0);
+}
+
+QTEST_GUILESS_MAIN(SshTargetsTest)
+
+#include "sshtargetstest.moc"
@@ -4,17 +4,17 @@
 #include "manualentrydialog.h"
 
 #include "../sshdiscovery.h"
+#include "../sshdns.h"
 #include "../sshhelper_common.h"
 
 #include <KLocalizedString>
 #include <KPluginFactory>
 
 #include <QAbstractItemView>
+#include <QCollator>
 #include <QComboBox>
 #include <QDir>
 #include <QHash>
-#include <QHostAddress>
-#include <QHostInfo>
 #include <QHeaderView>
 #include <QHBoxLayout>
 #include <QItemSelectionModel>
@@ -28,92 +28,24 @@
 #include <QVBoxLayout>
 
 #include <algorithm>
+#include <numeric>
+#include <vector>
 
 namespace
 {
-QString normalizedHost(const QString &host)
+QString resolveDnsNameForHost(const QString &host, SshHelper::DnsCache &cache, SshHelper::DnsResolver &resolver)
 {
-    QString candidate = host.trimmed();
-    if (candidate.isEmpty()) {
+    const QString address = SshHelper::reverseLookupAddress(host);
+    if (address.isEmpty()) {
         return {};
     }
 
-    const int atIndex = candidate.lastIndexOf(QLatin1Char('@'));
-    if (atIndex >= 0) {
-        candidate = candidate.mid(atIndex + 1);
+    QString name;
+    if (cache.lookup(address, &name) == SshHelper::DnsCache::Status::Unknown) {
+        name = resolver.reverseLookup(address);
+        cache.insert(address, name);
     }
-
-    if (candidate.startsWith(QLatin1Char('['))) {
-        const int closeIndex = candidate.indexOf(QLatin1Char(']'));
-        if (closeIndex > 1) {
-            candidate = candidate.mid(1, closeIndex - 1);
-        }
-    }
-
-    const int scopeIndex = candidate.indexOf(QLatin1Char('%'));
-    if (scopeIndex > 0) {
-        candidate = candidate.left(scopeIndex);
-    }
-
-    if (candidate.endsWith(QLatin1Char('.'))) {
-        candidate.chop(1);
-    }
-
-    return candidate;
-}
-
-QString resolveDnsNameForHost(const QString &host, QHash<QString, QString> &cache, QSet<QString> &failures)
-{
-    const QString normalized = normalizedHost(host);
-    if (normalized.isEmpty()) {
-        return {};
-    }
-
-    QString ipCandidate = normalized;
-    QHostAddress address;
-    if (!address.setAddress(ipCandidate)) {
-        if (ipCandidate.count(QLatin1Char(':')) == 1 && ipCandidate.contains(QLatin1Char('.'))) {
-            const QString stripped = ipCandidate.section(QLatin1Char(':'), 0, 0);
-            if (!address.setAddress(stripped)) {
-                return {};
-            }
-            ipCandidate = stripped;
-        } else {
-            return {};
-        }
-    }
-
-    if (cache.contains(ipCandidate)) {
-        return cache.value(ipCandidate);
-    }
-    if (failures.contains(ipCandidate)) {
-        return {};
-    }
-
-    const QHostInfo info = QHostInfo::fromName(ipCandidate);
-    if (info.error() != QHostInfo::NoError) {
-        failures.insert(ipCandidate);
-        return {};
-    }
-
-    QString resolved = info.hostName().trimmed();
-    if (resolved.endsWith(QLatin1Char('.'))) {
-        resolved.chop(1);
-    }
-
-    if (resolved.isEmpty() || resolved == ipCandidate) {
-        failures.insert(ipCandidate);
-        return {};
-    }
-
-    QHostAddress resolvedAddress;
-    if (resolvedAddress.setAddress(resolved)) {
-        failures.insert(ipCandidate);
-        return {};
-    }
-
-    cache.insert(ipCandidate, resolved);
-    return resolved;
+    return name;
 }
 } // namespace
 
@@ -250,8 +182,11 @@ void SshHelperConfigModule::refreshModel()
     updateTerminalControls();
 
     QVector<EntriesModel::EntryRecord> records;
-    QHash<QString, QString> dnsCache;
-    QSet<QString> dnsFailures;
+    const SshHelper::DnsCacheSettings dnsSettings = SshHelper::loadDnsCacheSettings();
+    SshHelper::DnsCache dnsCache;
+    dnsCache.setTimeToLive(dnsSettings.positiveTtl, dnsSettings.negativeTtl);
+    dnsCache.load();
+    SshHelper::SystemDnsResolver dnsResolver;
     records.reserve(discovered.size() + manualEntries.size());
 
     for (const auto &host : discovered) {
@@ -270,7 +205,7 @@ void SshHelperConfigModule::refreshModel()
         record.arguments = host.arguments;
         record.initialArguments = host.arguments;
         const QString hostName = host.hostName.isEmpty() ? host.alias : host.hostName;
-        record.dnsName = resolveDnsNameForHost(hostName, dnsCache, dnsFailures);
+        record.dnsName = resolveDnsNameForHost(hostName, dnsCache, dnsResolver);
         record.origin = host.origin;
         records.push_back(std::move(record));
     }
@@ -293,11 +228,27 @@ void SshHelperConfigModule::refreshModel()
         records.push_back(std::move(record));
     }
 
-    std::sort(records.begin(), records.end(), [](const EntriesModel::EntryRecord &lhs, const EntriesModel::EntryRecord &rhs) {
-        return QString::localeAwareCompare(lhs.label, rhs.label) < 0;
+    dnsCache.save();
+
+    // Collate every label once and sort on the keys.
+    const QCollator collator;
+    std::vector<QCollatorSortKey> sortKeys;
+    sortKeys.reserve(records.size());
+    for (const EntriesModel::EntryRecord &record : std::as_const(records)) {
+        sortKeys.push_back(collator.sortKey(record.label));
+    }
+    QVector<int> rows(records.size());
+    std::iota(rows.begin(), rows.end(), 0);
+    std::stable_sort(rows.begin(), rows.end(), [&sortKeys](int lhs, int rhs) {
+        return sortKeys[lhs].compare(sortKeys[rhs]) < 0;
     });
+    QVector<EntriesModel::EntryRecord> sorted;
+    sorted.reserve(records.size());
+    for (const int row : std::as_const(rows)) {
+        sorted.push_back(std::move(records[row]));
+    }
 
-    m_model->setEntries(std::move(records));
+    m_model->setEntries(std::move(sorted));
     m_model->markSaved();
     setNeedsSave(false);
 }
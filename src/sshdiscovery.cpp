@@ -2,11 +2,21 @@
 
 #include <KLocalizedString>
 
+#include <QByteArrayView>
+#include <QDataStream>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMessageAuthenticationCode>
 #include <QRegularExpression>
+#include <QSaveFile>
 #include <QSet>
 #include <QStringConverter>
 #include <QTextStream>
+#include <QtConcurrent>
+
+#include <glob.h>
 
 namespace
 {
@@ -28,6 +38,7 @@ struct ConfigState {
     QStringList hosts;
     QString hostname;
     QString user;
+    QString port;
 };
 
 void commitConfigState(const ConfigState &state, QVector<SshHelper::DiscoveredHost> &out, QSet<QString> &seenIds)
@@ -54,6 +65,9 @@ void commitConfigState(const ConfigState &state, QVector<SshHelper::DiscoveredHo
         entry.arguments = arguments;
         entry.hostName = state.hostname.isEmpty() ? alias : state.hostname;
         entry.userName = state.user;
+        bool validPort = false;
+        const int port = state.port.toInt(&validPort);
+        entry.port = validPort && port > 0 && port < 65536 ? port : -1;
         entry.origin = SshHelper::EntryOrigin::Config;
 
         if (!state.user.isEmpty() && !state.hostname.isEmpty()) {
@@ -69,17 +83,59 @@ void commitConfigState(const ConfigState &state, QVector<SshHelper::DiscoveredHo
     }
 }
 
-void parseConfigFile(const QString &path, QVector<SshHelper::DiscoveredHost> &out, QSet<QString> &seenIds)
+struct ConfigDirective {
+    QString keyword;
+    // Include patterns are stored already resolved to absolute paths.
+    QStringList arguments;
+};
+
+struct ConfigTree {
+    QHash<QString, QVector<ConfigDirective>> files;
+    QHash<QString, QStringList> expansions;
+};
+
+// Same limit as ssh's READCONF_MAX_DEPTH.
+constexpr int s_maxIncludeDepth = 16;
+
+QString resolveIncludePattern(QString pattern, const QString &baseDir)
+{
+    if (pattern.size() >= 2 && pattern.startsWith(QLatin1Char('"')) && pattern.endsWith(QLatin1Char('"'))) {
+        pattern = pattern.mid(1, pattern.size() - 2);
+    }
+    if (pattern == QLatin1String("~") || pattern.startsWith(QLatin1String("~/"))) {
+        return QDir::homePath() + pattern.mid(1);
+    }
+    // ssh resolves relative includes in user configs against ~/.ssh, not against the including file.
+    return QDir::isRelativePath(pattern) ? QDir(baseDir).filePath(pattern) : pattern;
+}
+
+QStringList expandIncludePattern(const QString &pattern)
+{
+    QStringList paths;
+    glob_t result;
+    if (::glob(QFile::encodeName(pattern).constData(), 0, nullptr, &result) == 0) {
+        for (size_t i = 0; i < result.gl_pathc; ++i) {
+            const QString path = QFile::decodeName(result.gl_pathv[i]);
+            if (QFileInfo(path).isFile()) {
+                paths.push_back(path);
+            }
+        }
+    }
+    ::globfree(&result);
+    return paths;
+}
+
+QVector<ConfigDirective> tokenizeConfigFile(const QString &path, const QString &baseDir)
 {
+    QVector<ConfigDirective> directives;
     QFile file(path);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return;
+        return directives;
     }
 
     QTextStream stream(&file);
     stream.setEncoding(QStringConverter::Utf8);
-
-    ConfigState state;
+    static const QRegularExpression whitespace(QStringLiteral("\\s+"));
 
     while (!stream.atEnd()) {
         const QString rawLine = stream.readLine();
@@ -88,29 +144,123 @@ void parseConfigFile(const QString &path, QVector<SshHelper::DiscoveredHost> &ou
             continue;
         }
 
-        const QStringList parts = stripped.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
+        QStringList parts = stripped.split(whitespace, Qt::SkipEmptyParts);
         if (parts.isEmpty()) {
             continue;
         }
 
-        const QString keyword = parts.constFirst().toLower();
-        if (keyword == QLatin1String("host")) {
-            commitConfigState(state, out, seenIds);
-            state.hosts = parts.mid(1);
-            state.hostname.clear();
-            state.user.clear();
-        } else if (keyword == QLatin1String("hostname")) {
-            if (parts.size() > 1) {
-                state.hostname = parts.at(1);
+        ConfigDirective directive;
+        directive.keyword = parts.takeFirst().toLower();
+        if (directive.keyword == QLatin1String("include")) {
+            for (const QString &pattern : std::as_const(parts)) {
+                directive.arguments.push_back(resolveIncludePattern(pattern, baseDir));
             }
-        } else if (keyword == QLatin1String("user")) {
-            if (parts.size() > 1) {
-                state.user = parts.at(1);
+        } else if (directive.keyword == QLatin1String("host") || directive.keyword == QLatin1String("hostname") || directive.keyword == QLatin1String("user")
+                   || directive.keyword == QLatin1String("port")) {
+            directive.arguments = std::move(parts);
+        } else {
+            continue;
+        }
+        directives.push_back(std::move(directive));
+    }
+    return directives;
+}
+
+// Reads the include graph breadth first, tokenizing every file of a level in parallel.
+ConfigTree loadConfigTree(const QString &rootPath, QStringList *includedPaths)
+{
+    const QString baseDir = QFileInfo(rootPath).absolutePath();
+    const auto tokenize = [&baseDir](const QString &path) {
+        return tokenizeConfigFile(path, baseDir);
+    };
+
+    ConfigTree tree;
+    tree.files.insert(rootPath, tokenize(rootPath));
+    QStringList level = {rootPath};
+    QSet<QString> queued = {rootPath};
+
+    for (int depth = 0; depth < s_maxIncludeDepth && !level.isEmpty(); ++depth) {
+        QStringList next;
+        for (const QString &path : std::as_const(level)) {
+            for (const ConfigDirective &directive : tree.files.value(path)) {
+                if (directive.keyword != QLatin1String("include")) {
+                    continue;
+                }
+                for (const QString &pattern : directive.arguments) {
+                    if (tree.expansions.contains(pattern)) {
+                        continue;
+                    }
+                    const QStringList expanded = expandIncludePattern(pattern);
+                    tree.expansions.insert(pattern, expanded);
+                    if (includedPaths) {
+                        // Watching the directory picks up files that start matching the pattern later.
+                        const QString directory = QFileInfo(pattern).absolutePath();
+                        if (!directory.contains(QLatin1Char('*')) && !directory.contains(QLatin1Char('?')) && !includedPaths->contains(directory)) {
+                            includedPaths->push_back(directory);
+                        }
+                    }
+                    for (const QString &included : expanded) {
+                        if (!queued.contains(included)) {
+                            queued.insert(included);
+                            next.push_back(included);
+                        }
+                    }
+                }
             }
         }
+
+        const QList<QVector<ConfigDirective>> tokenized = QtConcurrent::blockingMapped<QList<QVector<ConfigDirective>>>(next, tokenize);
+        for (qsizetype i = 0; i < next.size(); ++i) {
+            tree.files.insert(next.at(i), tokenized.at(i));
+        }
+        if (includedPaths) {
+            *includedPaths += next;
+        }
+        level = std::move(next);
     }
+    return tree;
+}
 
-    commitConfigState(state, out, seenIds);
+// Walks the tokenized files in declaration order, appending one block per Host line. Like ssh, an
+// included file starts out inside the block that includes it, and that block resumes afterwards.
+// chain holds the files being read, outermost first. A file that includes itself, directly or not,
+// makes ssh give up on the config; the walk stops there too and returns false, keeping the blocks
+// read so far. Stopping only the one include instead would still re-walk mutually including globs
+// along every path up to the depth limit.
+bool parseConfigFile(const ConfigTree &tree, const QString &path, QStringList &chain, QVector<ConfigState> &blocks, qsizetype current)
+{
+    chain.push_back(path);
+    for (const ConfigDirective &directive : tree.files.value(path)) {
+        if (directive.keyword == QLatin1String("host")) {
+            current = blocks.size();
+            blocks.push_back({directive.arguments, {}, {}, {}});
+        } else if (directive.keyword == QLatin1String("hostname")) {
+            if (!directive.arguments.isEmpty()) {
+                blocks[current].hostname = directive.arguments.constFirst();
+            }
+        } else if (directive.keyword == QLatin1String("user")) {
+            if (!directive.arguments.isEmpty()) {
+                blocks[current].user = directive.arguments.constFirst();
+            }
+        } else if (directive.keyword == QLatin1String("port")) {
+            if (!directive.arguments.isEmpty()) {
+                blocks[current].port = directive.arguments.constFirst();
+            }
+        } else if (directive.keyword == QLatin1String("include")) {
+            if (chain.size() > s_maxIncludeDepth) {
+                continue;
+            }
+            for (const QString &pattern : directive.arguments) {
+                for (const QString &included : tree.expansions.value(pattern)) {
+                    if (chain.contains(included) || !parseConfigFile(tree, included, chain, blocks, current)) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    chain.pop_back();
+    return true;
 }
 
 QString hostNameFromKnownHostsEntry(const QString &entry)
@@ -125,79 +275,445 @@ QString hostNameFromKnownHostsEntry(const QString &entry)
     return candidate;
 }
 
-void parseKnownHosts(const QString &path, QVector<SshHelper::DiscoveredHost> &out, QSet<QString> &seenIds)
+QByteArrayView stripComment(QByteArrayView line)
 {
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    bool inQuotes = false;
+    for (qsizetype i = 0; i < line.size(); ++i) {
+        const char c = line.at(i);
+        if (c == '"') {
+            inQuotes = !inQuotes;
+        } else if (c == '#' && !inQuotes) {
+            return line.first(i);
+        }
+    }
+    return line;
+}
+
+constexpr quint32 s_hashedHostsMagic = 0x5353484b; // "SSHK"
+constexpr quint16 s_hashedHostsVersion = 1;
+constexpr qsizetype s_hashedHostsBatchSize = 256;
+
+void parseHashedHost(QByteArrayView field, QVector<SshHelper::HashedKnownHost> &out)
+{
+    // |1|base64(salt)|base64(hash), SHA-1 sized on both sides.
+    if (!field.startsWith("|1|")) {
+        return;
+    }
+    const QByteArrayView encoded = field.sliced(3);
+    const qsizetype separator = encoded.indexOf('|');
+    if (separator <= 0) {
         return;
     }
 
-    QTextStream stream(&file);
-    stream.setEncoding(QStringConverter::Utf8);
+    SshHelper::HashedKnownHost entry;
+    entry.salt = QByteArray::fromBase64(encoded.first(separator).toByteArray());
+    entry.hash = QByteArray::fromBase64(encoded.sliced(separator + 1).toByteArray());
+    if (entry.salt.size() == 20 && entry.hash.size() == 20) {
+        out.push_back(std::move(entry));
+    }
+}
 
-    while (!stream.atEnd()) {
-        const QString stripped = stripComment(stream.readLine()).trimmed();
-        if (stripped.isEmpty()) {
-            continue;
+void parseKnownHostsLine(QByteArrayView line,
+                         const QString &description,
+                         QSet<QByteArrayView> &seenCandidates,
+                         QVector<SshHelper::DiscoveredHost> &out,
+                         QVector<SshHelper::HashedKnownHost> &hashedOut,
+                         QSet<QString> &seenIds)
+{
+    const QByteArrayView stripped = stripComment(line).trimmed();
+    if (stripped.isEmpty()) {
+        return;
+    }
+
+    const qsizetype spaceIndex = stripped.indexOf(' ');
+    const QByteArrayView hostsField = spaceIndex > 0 ? stripped.first(spaceIndex) : stripped;
+    if (hostsField.startsWith('|')) {
+        parseHashedHost(hostsField, hashedOut);
+        return;
+    }
+
+    qsizetype start = 0;
+    while (start <= hostsField.size()) {
+        qsizetype end = hostsField.indexOf(',', start);
+        if (end < 0) {
+            end = hostsField.size();
         }
-        if (stripped.startsWith(QLatin1Char('|'))) {
+        QByteArrayView candidate = hostsField.sliced(start, end - start).trimmed();
+        start = end + 1;
+        if (candidate.isEmpty()) {
             continue;
         }
 
-        const int spaceIndex = stripped.indexOf(QLatin1Char(' '));
-        const QString hostsField = spaceIndex > 0 ? stripped.left(spaceIndex) : stripped;
-        const QStringList hosts = hostsField.split(QLatin1Char(','), Qt::SkipEmptyParts);
-
-        for (const QString &host : hosts) {
-            QString candidate = host.trimmed();
+        QByteArrayView userName;
+        const qsizetype atIndex = candidate.lastIndexOf('@');
+        if (atIndex > 0) {
+            userName = candidate.first(atIndex);
+            candidate = candidate.sliced(atIndex + 1);
             if (candidate.isEmpty()) {
                 continue;
             }
-            QString userName;
-            const int atIndex = candidate.lastIndexOf(QLatin1Char('@'));
-            if (atIndex > 0) {
-                userName = candidate.left(atIndex);
-                candidate = candidate.mid(atIndex + 1);
-                if (candidate.isEmpty()) {
-                    continue;
-                }
-            }
-            if (candidate.startsWith(QLatin1Char('[')) && candidate.endsWith(QLatin1Char(']'))) {
-                candidate = candidate.mid(1, candidate.size() - 2);
-            }
+        }
+        if (candidate.size() >= 2 && candidate.startsWith('[') && candidate.endsWith(']')) {
+            candidate = candidate.sliced(1, candidate.size() - 2);
+        }
 
-            const QStringList arguments = {candidate};
-            const QString id = SshHelper::entryIdForArguments(arguments);
-            if (seenIds.contains(id)) {
-                continue;
-            }
+        // Only hosts that survive deduplication get owning strings and an id hash.
+        if (seenCandidates.contains(candidate)) {
+            continue;
+        }
+        seenCandidates.insert(candidate);
+
+        const QString host = QString::fromUtf8(candidate);
+        const QStringList arguments = {host};
+        const QString id = SshHelper::entryIdForArguments(arguments);
+        if (seenIds.contains(id)) {
+            continue;
+        }
+
+        SshHelper::DiscoveredHost entry;
+        entry.id = id;
+        entry.alias = host;
+        entry.description = description;
+        entry.arguments = arguments;
+        entry.hostName = hostNameFromKnownHostsEntry(host);
+        entry.userName = QString::fromUtf8(userName);
+        entry.origin = SshHelper::EntryOrigin::KnownHosts;
 
-            SshHelper::DiscoveredHost entry;
-            entry.id = id;
-            entry.alias = candidate;
-            entry.description = i18n("known_hosts entry");
-            entry.arguments = arguments;
-            entry.hostName = hostNameFromKnownHostsEntry(candidate);
-            entry.userName = userName;
-            entry.origin = SshHelper::EntryOrigin::KnownHosts;
+        out.push_back(std::move(entry));
+        seenIds.insert(id);
+    }
+}
 
-            out.push_back(std::move(entry));
-            seenIds.insert(id);
+struct HashedHostBatch {
+    QVector<qsizetype> entries;
+    const QList<QByteArray> *candidates = nullptr;
+};
+
+// Index into the batch's candidates of the match for each entry, or -1.
+QVector<qsizetype> matchHashedHostBatch(const QVector<SshHelper::HashedKnownHost> &entries, const HashedHostBatch &batch)
+{
+    QVector<qsizetype> matches;
+    matches.reserve(batch.entries.size());
+    for (const qsizetype index : batch.entries) {
+        const SshHelper::HashedKnownHost &entry = entries.at(index);
+        QMessageAuthenticationCode mac(QCryptographicHash::Sha1, entry.salt);
+        qsizetype found = -1;
+        for (qsizetype i = 0; i < batch.candidates->size(); ++i) {
+            mac.reset();
+            mac.addData(batch.candidates->at(i));
+            if (mac.resultView() == entry.hash) {
+                found = i;
+                break;
+            }
         }
+        matches.push_back(found);
+    }
+    return matches;
+}
+
+void queueHashedHostBatches(const QVector<qsizetype> &entries, const QList<QByteArray> *candidates, QVector<HashedHostBatch> &batches)
+{
+    if (candidates->isEmpty()) {
+        return;
+    }
+    for (qsizetype start = 0; start < entries.size(); start += s_hashedHostsBatchSize) {
+        HashedHostBatch batch;
+        batch.entries = entries.mid(start, s_hashedHostsBatchSize);
+        batch.candidates = candidates;
+        batches.push_back(std::move(batch));
     }
 }
 } // namespace
 
 namespace SshHelper
 {
-QVector<DiscoveredHost> discoverHosts(const QString &configPath, const QString &knownHostsPath)
+bool KnownHostsParser::update(const QString &path)
+{
+    const bool wasEmpty = m_hosts.isEmpty() && m_hashedHosts.isEmpty();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() <= 0) {
+        reset(path);
+        return wasEmpty;
+    }
+
+    const qint64 size = file.size();
+    QByteArray buffer;
+    QByteArrayView data;
+    if (const uchar *mapped = file.map(0, size)) {
+        data = QByteArrayView(reinterpret_cast<const char *>(mapped), size);
+    } else {
+        buffer = file.readAll();
+        data = buffer;
+    }
+
+    // ssh only ever appends; anything else (ssh-keygen -R, editors) rewrites the prefix.
+    const bool appendOnly = path == m_path && m_parsedSize > 0 && data.size() >= m_parsedSize && m_endsWithNewline
+        && qHash(data.first(m_parsedSize)) == m_prefixHash;
+    if (!appendOnly) {
+        reset(path);
+    }
+
+    const QString description = i18n("known_hosts entry");
+    QSet<QByteArrayView> seenCandidates;
+    m_appendedFrom = m_hosts.size();
+
+    qsizetype lineStart = appendOnly ? m_parsedSize : 0;
+    while (lineStart < data.size()) {
+        qsizetype lineEnd = data.indexOf('\n', lineStart);
+        if (lineEnd < 0) {
+            lineEnd = data.size();
+        }
+        parseKnownHostsLine(data.sliced(lineStart, lineEnd - lineStart), description, seenCandidates, m_hosts, m_hashedHosts, m_seenIds);
+        lineStart = lineEnd + 1;
+    }
+
+    m_parsedSize = data.size();
+    m_prefixHash = qHash(data);
+    m_endsWithNewline = data.endsWith('\n');
+    return appendOnly;
+}
+
+const QVector<DiscoveredHost> &KnownHostsParser::hosts() const
+{
+    return m_hosts;
+}
+
+const QVector<HashedKnownHost> &KnownHostsParser::hashedHosts() const
+{
+    return m_hashedHosts;
+}
+
+qsizetype KnownHostsParser::appendedFrom() const
+{
+    return m_appendedFrom;
+}
+
+void KnownHostsParser::reset(const QString &path)
+{
+    m_path = path;
+    m_hosts.clear();
+    m_hashedHosts.clear();
+    m_seenIds.clear();
+    m_parsedSize = 0;
+    m_prefixHash = 0;
+    m_endsWithNewline = false;
+    m_appendedFrom = 0;
+}
+
+HashedHostMatcher::HashedHostMatcher(const QString &filePath)
+    : m_filePath(filePath)
+{
+}
+
+QString HashedHostMatcher::defaultFilePath()
+{
+    return cacheFilePath(QStringLiteral("known_hosts_hashes"));
+}
+
+void HashedHostMatcher::load()
+{
+    m_matches.clear();
+    m_testedCandidates.clear();
+    m_dirty = false;
+
+    QFile file(m_filePath);
+    if (m_filePath.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != s_hashedHostsMagic || version != s_hashedHostsVersion) {
+        return;
+    }
+    stream >> m_testedCandidates >> m_matches;
+    if (stream.status() != QDataStream::Ok) {
+        m_matches.clear();
+        m_testedCandidates.clear();
+    }
+}
+
+bool HashedHostMatcher::save()
+{
+    if (!m_dirty || m_filePath.isEmpty()) {
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << s_hashedHostsMagic << s_hashedHostsVersion << m_testedCandidates << m_matches;
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+QVector<DiscoveredHost> HashedHostMatcher::match(const QVector<HashedKnownHost> &entries, const QSet<QString> &candidates)
+{
+    QSet<QString> candidateSet;
+    QList<QByteArray> allCandidates;
+    QList<QByteArray> newCandidates;
+    for (const QString &candidate : candidates) {
+        if (candidate.isEmpty()) {
+            continue;
+        }
+        candidateSet.insert(candidate);
+        allCandidates.push_back(candidate.toUtf8());
+        if (!m_testedCandidates.contains(candidate)) {
+            newCandidates.push_back(allCandidates.constLast());
+        }
+    }
+
+    // Unseen entries need every candidate; earlier misses only need the candidates added since.
+    QHash<QByteArray, QString> matches;
+    matches.reserve(entries.size());
+    QVector<qsizetype> unseen;
+    QVector<qsizetype> misses;
+    for (qsizetype i = 0; i < entries.size(); ++i) {
+        const QByteArray key = entries.at(i).salt + entries.at(i).hash;
+        const auto cached = m_matches.constFind(key);
+        if (cached == m_matches.cend()) {
+            unseen.push_back(i);
+        } else {
+            matches.insert(key, cached.value());
+            if (cached->isEmpty()) {
+                misses.push_back(i);
+            }
+        }
+    }
+
+    QVector<HashedHostBatch> batches;
+    queueHashedHostBatches(unseen, &allCandidates, batches);
+    queueHashedHostBatches(misses, &newCandidates, batches);
+    const QList<QVector<qsizetype>> results =
+        QtConcurrent::blockingMapped<QList<QVector<qsizetype>>>(batches, [&entries](const HashedHostBatch &batch) {
+            return matchHashedHostBatch(entries, batch);
+        });
+
+    for (qsizetype b = 0; b < batches.size(); ++b) {
+        const HashedHostBatch &batch = batches.at(b);
+        for (qsizetype i = 0; i < batch.entries.size(); ++i) {
+            const qsizetype found = results.at(b).at(i);
+            const HashedKnownHost &entry = entries.at(batch.entries.at(i));
+            matches.insert(entry.salt + entry.hash, found < 0 ? QString() : QString::fromUtf8(batch.candidates->at(found)));
+        }
+    }
+    for (const qsizetype i : std::as_const(unseen)) {
+        const QByteArray key = entries.at(i).salt + entries.at(i).hash;
+        if (!matches.contains(key)) {
+            matches.insert(key, QString());
+        }
+    }
+
+    if (!batches.isEmpty() || matches.size() != m_matches.size() || m_testedCandidates != candidateSet) {
+        m_dirty = true;
+    }
+    m_matches = std::move(matches);
+    m_testedCandidates = std::move(candidateSet);
+
+    const QString description = i18n("Hashed known_hosts entry");
+    QVector<DiscoveredHost> hosts;
+    QSet<QString> seenNames;
+    for (const HashedKnownHost &entry : entries) {
+        const QString name = m_matches.value(entry.salt + entry.hash);
+        if (name.isEmpty() || seenNames.contains(name)) {
+            continue;
+        }
+        seenNames.insert(name);
+
+        DiscoveredHost host;
+        host.alias = name;
+        host.arguments = {name};
+        host.id = entryIdForArguments(host.arguments);
+        host.description = description;
+        host.hostName = hostNameFromKnownHostsEntry(name);
+        host.origin = EntryOrigin::KnownHosts;
+        hosts.push_back(std::move(host));
+    }
+    return hosts;
+}
+
+void addHashedHostNames(QSet<QString> &names, const QString &host, int port)
+{
+    QString name = host.trimmed();
+    const qsizetype atIndex = name.lastIndexOf(QLatin1Char('@'));
+    if (atIndex >= 0) {
+        name = name.mid(atIndex + 1);
+    }
+    if (name.startsWith(QLatin1Char('['))) {
+        const qsizetype closeIndex = name.indexOf(QLatin1Char(']'));
+        if (closeIndex <= 1) {
+            return;
+        }
+        if (name.size() > closeIndex + 2 && name.at(closeIndex + 1) == QLatin1Char(':')) {
+            bool ok = false;
+            const int written = QStringView(name).sliced(closeIndex + 2).toInt(&ok);
+            if (ok) {
+                port = written;
+            }
+        }
+        name = name.mid(1, closeIndex - 1);
+    }
+    if (name.endsWith(QLatin1Char('.'))) {
+        name.chop(1);
+    }
+    // ssh lowercases the name before hashing it.
+    name = name.toLower();
+    if (name.isEmpty()) {
+        return;
+    }
+    names.insert(name);
+    if (port > 0 && port != 22) {
+        names.insert(QStringLiteral("[%1]:%2").arg(name).arg(port));
+    }
+}
+
+QVector<DiscoveredHost> discoverConfigHosts(const QString &configPath, QStringList *includedPaths)
 {
     QVector<DiscoveredHost> hosts;
     QSet<QString> seenIds;
     hosts.reserve(64);
 
-    parseConfigFile(configPath, hosts, seenIds);
-    parseKnownHosts(knownHostsPath, hosts, seenIds);
+    const ConfigTree tree = loadConfigTree(configPath, includedPaths);
+    // Block 0 collects directives before the first Host line; it has no hosts and commits nothing.
+    QVector<ConfigState> blocks(1);
+    QStringList chain;
+    parseConfigFile(tree, configPath, chain, blocks, 0);
+    // Blocks are committed in declaration order so the first definition of a host still wins.
+    for (const ConfigState &block : std::as_const(blocks)) {
+        commitConfigState(block, hosts, seenIds);
+    }
+    return hosts;
+}
+
+QVector<DiscoveredHost> discoverHosts(const QString &configPath, const QString &knownHostsPath)
+{
+    QVector<DiscoveredHost> hosts = discoverConfigHosts(configPath);
+    QSet<QString> seenIds;
+    seenIds.reserve(hosts.size());
+    for (const DiscoveredHost &host : std::as_const(hosts)) {
+        seenIds.insert(host.id);
+    }
+
+    KnownHostsParser knownHosts;
+    knownHosts.update(knownHostsPath);
+    hosts.reserve(hosts.size() + knownHosts.hosts().size());
+    for (const DiscoveredHost &host : knownHosts.hosts()) {
+        if (!seenIds.contains(host.id)) {
+            hosts.push_back(host);
+            seenIds.insert(host.id);
+        }
+    }
 
     return hosts;
 }
@@ -2,6 +2,9 @@
 
 #include "sshhelper_common.h"
 
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 #include <QVector>
@@ -15,8 +18,69 @@ struct DiscoveredHost {
     QStringList arguments;
     QString hostName;
     QString userName;
+    // Port from ssh_config, or -1.
+    int port = -1;
     EntryOrigin origin = EntryOrigin::Config;
 };
 
+// A known_hosts entry written with HashKnownHosts: the host is only stored as HMAC-SHA1(salt, host).
+struct HashedKnownHost {
+    QByteArray salt;
+    QByteArray hash;
+};
+
+// Keeps the parsed state of a known_hosts file so appended lines can be parsed on their own.
+class KnownHostsParser
+{
+public:
+    // Returns true when only data appended since the previous call was parsed.
+    bool update(const QString &path);
+
+    const QVector<DiscoveredHost> &hosts() const;
+    const QVector<HashedKnownHost> &hashedHosts() const;
+    // Index into hosts() of the first entry added by the last update().
+    qsizetype appendedFrom() const;
+
+private:
+    void reset(const QString &path);
+
+    QString m_path;
+    QVector<DiscoveredHost> m_hosts;
+    QVector<HashedKnownHost> m_hashedHosts;
+    QSet<QString> m_seenIds;
+    qint64 m_parsedSize = 0;
+    size_t m_prefixHash = 0;
+    bool m_endsWithNewline = false;
+    qsizetype m_appendedFrom = 0;
+};
+
+// Recovers hashed known_hosts entries by hashing names the user is known to connect to.
+class HashedHostMatcher
+{
+public:
+    explicit HashedHostMatcher(const QString &filePath = defaultFilePath());
+
+    static QString defaultFilePath();
+
+    void load();
+    bool save();
+
+    // Returns one host per distinct candidate that matches at least one entry.
+    QVector<DiscoveredHost> match(const QVector<HashedKnownHost> &entries, const QSet<QString> &candidates);
+
+private:
+    QString m_filePath;
+    // Keyed by salt + hash; an empty name means no candidate in m_testedCandidates matched.
+    QHash<QByteArray, QString> m_matches;
+    QSet<QString> m_testedCandidates;
+    bool m_dirty = false;
+};
+
+// Hosts declared in ssh_config and the files it includes. includedPaths receives the files pulled in
+// through Include, and the directories their patterns match in.
+QVector<DiscoveredHost> discoverConfigHosts(const QString &configPath, QStringList *includedPaths = nullptr);
 QVector<DiscoveredHost> discoverHosts(const QString &configPath, const QString &knownHostsPath);
+// Adds the names ssh may have hashed for a host connected to on port: the name lowercased, and
+// "[name]:port" when the port is not 22. A host written as "[name]:port" brings its own port.
+void addHashedHostNames(QSet<QString> &names, const QString &host, int port = -1);
 }
@@ -0,0 +1,300 @@
+#include "sshdns.h"
+
+#include "sshhelper_common.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QHostInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include <utility>
+
+namespace
+{
+constexpr quint32 s_dnsCacheMagic = 0x53534844; // "SSHD"
+constexpr quint16 s_dnsCacheVersion = 1;
+} // namespace
+
+namespace SshHelper
+{
+QString normalizedHost(const QString &host)
+{
+    QString candidate = host.trimmed();
+    if (candidate.isEmpty()) {
+        return {};
+    }
+
+    const int atIndex = candidate.lastIndexOf(QLatin1Char('@'));
+    if (atIndex >= 0) {
+        candidate = candidate.mid(atIndex + 1);
+    }
+
+    if (candidate.startsWith(QLatin1Char('['))) {
+        const int closeIndex = candidate.indexOf(QLatin1Char(']'));
+        if (closeIndex > 1) {
+            candidate = candidate.mid(1, closeIndex - 1);
+        }
+    }
+
+    const int scopeIndex = candidate.indexOf(QLatin1Char('%'));
+    if (scopeIndex > 0) {
+        candidate = candidate.left(scopeIndex);
+    }
+
+    if (candidate.endsWith(QLatin1Char('.'))) {
+        candidate.chop(1);
+    }
+
+    return candidate;
+}
+
+QString reverseLookupAddress(const QString &host)
+{
+    const QString normalized = normalizedHost(host);
+    if (normalized.isEmpty()) {
+        return {};
+    }
+
+    QHostAddress address;
+    if (address.setAddress(normalized)) {
+        return normalized;
+    }
+
+    if (normalized.count(QLatin1Char(':')) == 1 && normalized.contains(QLatin1Char('.'))) {
+        const QString stripped = normalized.section(QLatin1Char(':'), 0, 0);
+        if (address.setAddress(stripped)) {
+            return stripped;
+        }
+    }
+
+    return {};
+}
+
+DnsCache::DnsCache(const QString &filePath)
+    : m_filePath(filePath)
+{
+}
+
+QString DnsCache::defaultFilePath()
+{
+    return cacheFilePath(QStringLiteral("dns_cache"));
+}
+
+void DnsCache::setTimeToLive(qint64 positiveSeconds, qint64 negativeSeconds)
+{
+    m_positiveTtl = qMax<qint64>(0, positiveSeconds);
+    m_negativeTtl = qMax<qint64>(0, negativeSeconds);
+}
+
+void DnsCache::load()
+{
+    m_entries = readEntries(m_filePath);
+    m_dirty = false;
+}
+
+bool DnsCache::save()
+{
+    if (!m_dirty || m_filePath.isEmpty()) {
+        return true;
+    }
+
+    // Another process (runner or KCM) may have written newer results since we loaded.
+    QHash<QString, Entry> merged = readEntries(m_filePath);
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        const auto existing = merged.constFind(it.key());
+        if (existing == merged.cend() || existing->timestamp <= it->timestamp) {
+            merged.insert(it.key(), it.value());
+        }
+    }
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    for (auto it = merged.begin(); it != merged.end();) {
+        if (isExpired(it.value(), now)) {
+            it = merged.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << s_dnsCacheMagic << s_dnsCacheVersion << static_cast<quint32>(merged.size());
+    for (auto it = merged.cbegin(); it != merged.cend(); ++it) {
+        stream << it.key() << it->name << it->timestamp;
+    }
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        return false;
+    }
+
+    m_entries = std::move(merged);
+    m_dirty = false;
+    return true;
+}
+
+DnsCache::Status DnsCache::lookup(const QString &address, QString *name) const
+{
+    const auto it = m_entries.constFind(address);
+    if (it == m_entries.cend() || isExpired(it.value(), QDateTime::currentSecsSinceEpoch())) {
+        return Status::Unknown;
+    }
+    if (it->name.isEmpty()) {
+        return Status::Failed;
+    }
+    if (name) {
+        *name = it->name;
+    }
+    return Status::Resolved;
+}
+
+void DnsCache::insert(const QString &address, const QString &name)
+{
+    if (address.isEmpty()) {
+        return;
+    }
+    Entry entry;
+    entry.name = name;
+    entry.timestamp = QDateTime::currentSecsSinceEpoch();
+    m_entries.insert(address, entry);
+    m_dirty = true;
+}
+
+bool DnsCache::isExpired(const Entry &entry, qint64 now) const
+{
+    const qint64 ttl = entry.name.isEmpty() ? m_negativeTtl : m_positiveTtl;
+    return now - entry.timestamp > ttl;
+}
+
+QHash<QString, DnsCache::Entry> DnsCache::readEntries(const QString &filePath)
+{
+    QHash<QString, Entry> entries;
+    if (filePath.isEmpty()) {
+        return entries;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return entries;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != s_dnsCacheMagic || version != s_dnsCacheVersion) {
+        return entries;
+    }
+
+    entries.reserve(count);
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString address;
+        Entry entry;
+        stream >> address >> entry.name >> entry.timestamp;
+        if (stream.status() == QDataStream::Ok && !address.isEmpty()) {
+            entries.insert(address, entry);
+        }
+    }
+    return entries;
+}
+
+QString SystemDnsResolver::reverseLookup(const QString &address)
+{
+    const QHostInfo info = QHostInfo::fromName(address);
+    if (info.error() != QHostInfo::NoError) {
+        return {};
+    }
+
+    QString resolved = info.hostName().trimmed();
+    if (resolved.endsWith(QLatin1Char('.'))) {
+        resolved.chop(1);
+    }
+
+    if (resolved.isEmpty() || resolved == address) {
+        return {};
+    }
+
+    QHostAddress resolvedAddress;
+    if (resolvedAddress.setAddress(resolved)) {
+        return {};
+    }
+
+    return resolved;
+}
+
+AsyncDnsResolver::AsyncDnsResolver(std::shared_ptr<DnsResolver> resolver, int maxConcurrentLookups, QObject *parent)
+    : QObject(parent)
+    , m_resolver(std::move(resolver))
+{
+    m_pool.setMaxThreadCount(qMax(1, maxConcurrentLookups));
+}
+
+AsyncDnsResolver::~AsyncDnsResolver()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void AsyncDnsResolver::setResolver(std::shared_ptr<DnsResolver> resolver)
+{
+    QMutexLocker locker(&m_mutex);
+    m_resolver = std::move(resolver);
+}
+
+void AsyncDnsResolver::resolve(const QStringList &addresses)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_resolver) {
+        return;
+    }
+
+    for (const QString &address : addresses) {
+        if (address.isEmpty() || m_inFlight.contains(address)) {
+            continue;
+        }
+        m_inFlight.insert(address);
+        const std::shared_ptr<DnsResolver> resolver = m_resolver;
+        m_pool.start([this, resolver, address]() {
+            finishLookup(address, resolver->reverseLookup(address));
+        });
+    }
+}
+
+void AsyncDnsResolver::finishLookup(const QString &address, const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    m_inFlight.remove(address);
+    m_pendingResults.insert(address, name);
+    if (!m_flushQueued) {
+        m_flushQueued = true;
+        QMetaObject::invokeMethod(this, &AsyncDnsResolver::flushResults, Qt::QueuedConnection);
+    }
+}
+
+void AsyncDnsResolver::flushResults()
+{
+    QHash<QString, QString> results;
+    {
+        QMutexLocker locker(&m_mutex);
+        results.swap(m_pendingResults);
+        m_flushQueued = false;
+    }
+
+    if (!results.isEmpty()) {
+        Q_EMIT resultsReady(results);
+    }
+}
+} // namespace SshHelper
+
+#include "moc_sshdns.cpp"
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <memory>
+
+namespace SshHelper
+{
+QString normalizedHost(const QString &host);
+QString reverseLookupAddress(const QString &host);
+
+class DnsCache
+{
+public:
+    enum class Status {
+        Unknown,
+        Resolved,
+        Failed
+    };
+
+    explicit DnsCache(const QString &filePath = defaultFilePath());
+
+    static QString defaultFilePath();
+
+    void setTimeToLive(qint64 positiveSeconds, qint64 negativeSeconds);
+    void load();
+    bool save();
+
+    Status lookup(const QString &address, QString *name) const;
+    // An empty name records a failed lookup.
+    void insert(const QString &address, const QString &name);
+
+private:
+    struct Entry {
+        QString name;
+        qint64 timestamp = 0;
+    };
+
+    bool isExpired(const Entry &entry, qint64 now) const;
+    static QHash<QString, Entry> readEntries(const QString &filePath);
+
+    QString m_filePath;
+    QHash<QString, Entry> m_entries;
+    qint64 m_positiveTtl = 7 * 24 * 60 * 60;
+    qint64 m_negativeTtl = 60 * 60;
+    bool m_dirty = false;
+};
+
+class DnsResolver
+{
+public:
+    virtual ~DnsResolver() = default;
+
+    // Blocking reverse lookup, called from worker threads. Returns an empty string when no usable name exists.
+    virtual QString reverseLookup(const QString &address) = 0;
+};
+
+class SystemDnsResolver : public DnsResolver
+{
+public:
+    QString reverseLookup(const QString &address) override;
+};
+
+class AsyncDnsResolver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AsyncDnsResolver(std::shared_ptr<DnsResolver> resolver, int maxConcurrentLookups = 8, QObject *parent = nullptr);
+    ~AsyncDnsResolver() override;
+
+    void setResolver(std::shared_ptr<DnsResolver> resolver);
+    void resolve(const QStringList &addresses);
+
+Q_SIGNALS:
+    // Values are empty for addresses that did not resolve.
+    void resultsReady(const QHash<QString, QString> &results);
+
+private:
+    void finishLookup(const QString &address, const QString &name);
+    void flushResults();
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    std::shared_ptr<DnsResolver> m_resolver;
+    QSet<QString> m_inFlight;
+    QHash<QString, QString> m_pendingResults;
+    bool m_flushQueued = false;
+};
+} // namespace SshHelper
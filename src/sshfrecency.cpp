@@ -0,0 +1,153 @@
+#include "sshfrecency.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cmath>
+
+namespace
+{
+constexpr double s_halfLifeSeconds = 7 * 24 * 60 * 60;
+// Entries decayed below this are dropped when the log is compacted.
+constexpr double s_minimumScore = 0.01;
+constexpr qsizetype s_minimumCompactionRecords = 512;
+
+double decay(qint64 elapsedSeconds)
+{
+    return std::exp2(-static_cast<double>(elapsedSeconds) / s_halfLifeSeconds);
+}
+
+QByteArray formatRecord(qint64 timestamp, double weight, const QString &id)
+{
+    return QByteArray::number(timestamp) + ' ' + QByteArray::number(weight, 'g', 9) + ' ' + id.toUtf8() + '\n';
+}
+} // namespace
+
+namespace SshHelper
+{
+LaunchHistory::LaunchHistory(const QString &filePath)
+    : m_filePath(filePath)
+{
+}
+
+QString LaunchHistory::defaultFilePath()
+{
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    if (dataDir.isEmpty()) {
+        return {};
+    }
+    return QDir(dataDir).filePath(QStringLiteral("krunner_sshhelper/launch_history"));
+}
+
+void LaunchHistory::load()
+{
+    m_entries.clear();
+    m_records = 0;
+
+    QFile file(m_filePath);
+    if (m_filePath.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // Each line is "<seconds since epoch> <weight> <id>". Launches have weight 1, compacted
+    // lines carry the decayed score of everything they replaced.
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        const qsizetype first = line.indexOf(' ');
+        const qsizetype second = first > 0 ? line.indexOf(' ', first + 1) : -1;
+        if (second < 0) {
+            continue;
+        }
+
+        bool timestampOk = false;
+        bool weightOk = false;
+        const qint64 timestamp = line.first(first).toLongLong(&timestampOk);
+        const double weight = line.sliced(first + 1, second - first - 1).toDouble(&weightOk);
+        const QString id = QString::fromUtf8(line.sliced(second + 1));
+        if (timestampOk && weightOk && weight > 0.0 && !id.isEmpty()) {
+            fold(id, timestamp, weight);
+            ++m_records;
+        }
+    }
+    file.close();
+
+    if (m_records > qMax(s_minimumCompactionRecords, 2 * m_entries.size())) {
+        compact(QDateTime::currentSecsSinceEpoch());
+    }
+}
+
+bool LaunchHistory::record(const QString &id)
+{
+    if (id.isEmpty()) {
+        return false;
+    }
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    fold(id, now, 1.0);
+    ++m_records;
+
+    if (m_filePath.isEmpty()) {
+        return false;
+    }
+    if (m_records > qMax(s_minimumCompactionRecords, 2 * m_entries.size())) {
+        return compact(now);
+    }
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    return file.write(formatRecord(now, 1.0, id)) > 0;
+}
+
+QHash<QString, double> LaunchHistory::scores() const
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QHash<QString, double> scores;
+    scores.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        scores.insert(it.key(), it->score * decay(qMax<qint64>(0, now - it->timestamp)));
+    }
+    return scores;
+}
+
+void LaunchHistory::fold(const QString &id, qint64 timestamp, double weight)
+{
+    Entry &entry = m_entries[id];
+    if (timestamp >= entry.timestamp) {
+        entry.score = entry.score * decay(timestamp - entry.timestamp) + weight;
+        entry.timestamp = timestamp;
+    } else {
+        entry.score += weight * decay(entry.timestamp - timestamp);
+    }
+}
+
+bool LaunchHistory::compact(qint64 now)
+{
+    QByteArray data;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        const double score = it->score * decay(qMax<qint64>(0, now - it->timestamp));
+        if (score < s_minimumScore) {
+            it = m_entries.erase(it);
+            continue;
+        }
+        it->score = score;
+        it->timestamp = now;
+        data += formatRecord(now, score, it.key());
+        ++it;
+    }
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        return false;
+    }
+    m_records = m_entries.size();
+    return true;
+}
+} // namespace SshHelper
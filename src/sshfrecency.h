@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+
+namespace SshHelper
+{
+// Launch counts per target id, decayed exponentially so recent use outweighs old habits.
+class LaunchHistory
+{
+public:
+    explicit LaunchHistory(const QString &filePath = defaultFilePath());
+
+    static QString defaultFilePath();
+
+    void load();
+    // Appends one record; the log is rewritten once it holds too many superseded records.
+    bool record(const QString &id);
+
+    // Decayed scores as of now; one launch right now is worth 1.0.
+    QHash<QString, double> scores() const;
+
+private:
+    struct Entry {
+        double score = 0.0;
+        qint64 timestamp = 0;
+    };
+
+    void fold(const QString &id, qint64 timestamp, double weight);
+    bool compact(qint64 now);
+
+    QString m_filePath;
+    QHash<QString, Entry> m_entries;
+    qsizetype m_records = 0;
+};
+} // namespace SshHelper
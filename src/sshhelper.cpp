@@ -1,7 +1,10 @@
 #include "sshhelper.h"
 
 #include "sshdiscovery.h"
+#include "sshdns.h"
 #include "sshhelper_common.h"
+#include "sshlauncher.h"
+#include "sshsnapshot.h"
 
 #include <KLocalizedString>
 #include <KPluginFactory>
@@ -9,18 +12,17 @@
 #include <KRunner/RunnerSyntax>
 
 #include <QDir>
-#include <QFile>
-#include <QHostAddress>
-#include <QHostInfo>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QLoggingCategory>
 #include <QProcess>
-#include <QRegularExpression>
 #include <QSet>
 #include <QStandardPaths>
 #include <KConfigWatcher>
 #include <KSharedConfig>
 
 #include <algorithm>
+#include <numeric>
 #include <utility>
 
 K_PLUGIN_CLASS_WITH_JSON(SshHelperRunner, "sshhelper.json")
@@ -29,7 +31,51 @@ Q_LOGGING_CATEGORY(LOG_SSHHELPER, "org.kde.runners.sshhelper")
 
 namespace
 {
-bool launchWithCustomDescriptor(const QString &descriptor, const QStringList &sshArgs)
+// Weight of launch history in a match's relevance, and the decayed launch count worth half of it.
+constexpr double s_frecencyWeight = 0.15;
+constexpr double s_frecencySaturation = 5.0;
+
+// The typo-tolerant pass runs when fewer results than this were found.
+constexpr qsizetype s_typoFallbackThreshold = 3;
+
+// Targets scored between checks for a query KRunner has already replaced.
+constexpr qsizetype s_cancellationCheckInterval = 256;
+
+// Relabeling more than this fraction of the targets re-sorts the order instead of moving each one.
+constexpr qsizetype s_resortFraction = 8;
+
+struct ScoredTarget {
+    double relevance = 0.0;
+    qsizetype position = 0;
+    int slot = 0;
+};
+
+QString snapshotFilePath()
+{
+    return SshHelper::cacheFilePath(QStringLiteral("hosts_snapshot"));
+}
+
+// One run() request: where processes are started, and when the match was picked.
+struct Launch {
+    SshHelper::ProcessLauncher &launcher;
+    QElapsedTimer sinceRun;
+};
+
+bool startProcess(const Launch &launch, const QString &terminal, const QString &executable, const QStringList &arguments)
+{
+    QString errorString;
+    const int error = launch.launcher.startDetached(executable, arguments, &errorString);
+    const SshHelper::LaunchStatistics totals = launch.launcher.record(terminal, error == 0);
+    if (error != 0) {
+        qCWarning(LOG_SSHHELPER) << "Could not start" << terminal << ":" << errorString << "; started" << totals.succeeded << "failed" << totals.failed;
+        return false;
+    }
+    qCDebug(LOG_SSHHELPER) << "Started" << terminal << launch.sinceRun.nsecsElapsed() / 1000 << "us after the match was run; started" << totals.succeeded
+                           << "failed" << totals.failed;
+    return true;
+}
+
+bool launchWithCustomDescriptor(const Launch &launch, const QString &descriptor, const QStringList &sshArgs)
 {
     if (descriptor.isEmpty()) {
         return false;
@@ -41,7 +87,7 @@ bool launchWithCustomDescriptor(const QString &descriptor, const QStringList &ss
     }
 
     const QString program = parts.takeFirst();
-    const QString executable = QStandardPaths::findExecutable(program);
+    const QString executable = SshHelper::findExecutable(program);
     if (executable.isEmpty()) {
         return false;
     }
@@ -49,12 +95,12 @@ bool launchWithCustomDescriptor(const QString &descriptor, const QStringList &ss
     QStringList arguments = parts;
     arguments << QStringLiteral("ssh");
     arguments += sshArgs;
-    return QProcess::startDetached(executable, arguments);
+    return startProcess(launch, program, executable, arguments);
 }
 
-bool launchWithDashE(const QString &program, const QStringList &sshArgs, const QStringList &extraArgs = {})
+bool launchWithDashE(const Launch &launch, const QString &program, const QStringList &sshArgs, const QStringList &extraArgs = {})
 {
-    const QString executable = QStandardPaths::findExecutable(program);
+    const QString executable = SshHelper::findExecutable(program);
     if (executable.isEmpty()) {
         return false;
     }
@@ -63,12 +109,12 @@ bool launchWithDashE(const QString &program, const QStringList &sshArgs, const Q
     arguments << QStringLiteral("-e");
     arguments << QStringLiteral("ssh");
     arguments += sshArgs;
-    return QProcess::startDetached(executable, arguments);
+    return startProcess(launch, program, executable, arguments);
 }
 
-bool launchWithDoubleDash(const QString &program, const QStringList &sshArgs, const QStringList &extraArgs = {})
+bool launchWithDoubleDash(const Launch &launch, const QString &program, const QStringList &sshArgs, const QStringList &extraArgs = {})
 {
-    const QString executable = QStandardPaths::findExecutable(program);
+    const QString executable = SshHelper::findExecutable(program);
     if (executable.isEmpty()) {
         return false;
     }
@@ -77,49 +123,50 @@ bool launchWithDoubleDash(const QString &program, const QStringList &sshArgs, co
     arguments << QStringLiteral("--");
     arguments << QStringLiteral("ssh");
     arguments += sshArgs;
-    return QProcess::startDetached(executable, arguments);
+    return startProcess(launch, program, executable, arguments);
 }
 
-double subsequenceScore(const QString &text, const QString &pattern)
+// Higher relevance first; ties keep the display order.
+bool rankedBefore(const ScoredTarget &lhs, const ScoredTarget &rhs)
 {
-    if (pattern.isEmpty() || text.isEmpty()) {
-        return 0.0;
+    if (lhs.relevance != rhs.relevance) {
+        return lhs.relevance > rhs.relevance;
     }
+    return lhs.position < rhs.position;
+}
 
-    int firstIndex = -1;
-    int lastIndex = -1;
-    int previousIndex = -1;
-    int bestBlock = 0;
-    int currentBlock = 0;
-    int matched = 0;
+// Scores are not monotone in the query, but whether a target matches is: every match
+// means each token is a subsequence of some field, and so is every prefix of a token.
+// That only holds while the extension does not start a new token.
+bool refinesQuery(const QString &current, const QString &previous)
+{
+    return current.startsWith(previous) && !QStringView(current).mid(previous.size()).contains(QLatin1Char(' '));
+}
 
-    for (const QChar &c : pattern) {
-        const int foundIndex = text.indexOf(c, previousIndex + 1);
-        if (foundIndex < 0) {
-            return 0.0;
-        }
-        if (firstIndex == -1) {
-            firstIndex = foundIndex;
+// The last "-p port" in an ssh command line, as ssh would use it, or -1.
+int portFromArguments(const QStringList &arguments)
+{
+    int port = -1;
+    for (int i = 0; i < arguments.size(); ++i) {
+        const QString &arg = arguments.at(i);
+        if (arg == QLatin1String("--")) {
+            break;
         }
-        lastIndex = foundIndex;
-        if (foundIndex == previousIndex + 1) {
-            ++currentBlock;
+        QString value;
+        if (arg == QLatin1String("-p") && i + 1 < arguments.size()) {
+            value = arguments.at(++i);
+        } else if (arg.startsWith(QLatin1String("-p")) && arg.size() > 2) {
+            value = arg.mid(2);
         } else {
-            currentBlock = 1;
+            continue;
+        }
+        bool ok = false;
+        const int parsed = value.toInt(&ok);
+        if (ok) {
+            port = parsed;
         }
-        bestBlock = qMax(bestBlock, currentBlock);
-        previousIndex = foundIndex;
-        ++matched;
     }
-
-    const int span = qMax(1, lastIndex - firstIndex + 1);
-    const double coverage = static_cast<double>(matched) / static_cast<double>(pattern.size());
-    const double density = static_cast<double>(matched) / static_cast<double>(span);
-    const double continuity = static_cast<double>(bestBlock) / static_cast<double>(pattern.size());
-    const double prefixBoost = firstIndex == 0 ? 0.15 : 0.0;
-
-    const double weighted = (0.45 * coverage) + (0.35 * continuity) + (0.20 * density) + prefixBoost;
-    return qBound(0.0, weighted, 1.0);
+    return port;
 }
 } // namespace
 
@@ -133,20 +180,40 @@ SshHelperRunner::SshHelperRunner(QObject *parent, const KPluginMetaData &metaDat
     addSyntax(KRunner::RunnerSyntax(QStringLiteral("ssh :q"), i18n("Start an SSH session that matches :q.")));
     addSyntax(KRunner::RunnerSyntax(QStringLiteral("ssh"), i18n("List SSH sessions you have used before.")));
 
-    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &SshHelperRunner::scheduleReload);
-    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &SshHelperRunner::scheduleReload);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &SshHelperRunner::watchedFileChanged);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &SshHelperRunner::watchedDirectoryChanged);
 
     m_reloadTimer.setSingleShot(true);
     m_reloadTimer.setInterval(250);
-    connect(&m_reloadTimer, &QTimer::timeout, this, &SshHelperRunner::reloadHosts);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &SshHelperRunner::startBackgroundReload);
+
+    m_persistPool.setMaxThreadCount(1);
+    m_reloadPool.setMaxThreadCount(1);
+
+    m_launcher = new SshHelper::ProcessLauncher(this);
+
+    m_dnsResolver = new SshHelper::AsyncDnsResolver(std::make_shared<SshHelper::SystemDnsResolver>(), 8, this);
+    connect(m_dnsResolver, &SshHelper::AsyncDnsResolver::resultsReady, this, &SshHelperRunner::mergeDnsResults);
+
+    m_history.load();
+    publishFrecency();
 
     m_config = KSharedConfig::openConfig(QStringLiteral("krunner_sshhelperrc"));
     if (m_config) {
         m_configWatcher = KConfigWatcher::create(m_config);
-        connect(m_configWatcher.data(), &KConfigWatcher::configChanged, this, &SshHelperRunner::scheduleReload);
+        connect(m_configWatcher.data(), &KConfigWatcher::configChanged, this, &SshHelperRunner::settingsChanged);
     }
 }
 
+SshHelperRunner::~SshHelperRunner()
+{
+    // Let a running reload finish without picking up further work; it still uses the members below.
+    m_reloadTimer.stop();
+    m_pendingSources.storeRelaxed(0);
+    m_reloadPool.clear();
+    m_reloadPool.waitForDone();
+}
+
 void SshHelperRunner::match(KRunner::RunnerContext &context)
 {
     const QString query = context.query().trimmed();
@@ -154,100 +221,227 @@ void SshHelperRunner::match(KRunner::RunnerContext &context)
         return;
     }
 
-    ensureHostsLoaded();
-    if (m_targets.isEmpty()) {
+    const std::shared_ptr<const HostSnapshot> snapshot = ensureHostsLoaded();
+    if (!snapshot || snapshot->targets.isEmpty()) {
         return;
     }
+    const SshHelper::TargetTable &targets = snapshot->targets;
 
-    QString pattern = query.mid(3).trimmed();
-    QString searchPattern = pattern;
-    QString explicitUser;
-    const QRegularExpression userPattern(QStringLiteral("^([^\\s@]+)@(.+)$"));
-    const QRegularExpressionMatch userMatch = userPattern.match(pattern);
-    if (userMatch.hasMatch()) {
-        const QString hostPart = userMatch.captured(2).trimmed();
-        if (!hostPart.isEmpty()) {
-            explicitUser = userMatch.captured(1).trimmed();
-            searchPattern = hostPart;
+    const SshHelper::HostQuery hostQuery = SshHelper::parseHostQuery(query.mid(3).trimmed());
+    const bool showAll = hostQuery.searchText.isEmpty();
+    const SshHelper::SearchQuery searchQuery = SshHelper::compileSearchQuery(hostQuery.searchText);
+    const SshHelper::SearchQuery fullQuery = SshHelper::compileSearchQuery(hostQuery.fullText);
+    const auto passesFilters = [&hostQuery, &targets](int slot) {
+        if (hostQuery.origin && targets.origin(slot) != *hostQuery.origin) {
+            return false;
+        }
+        return hostQuery.userFilter.isEmpty() || targets.userName(slot).compare(hostQuery.userFilter, Qt::CaseInsensitive) == 0;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<int> candidates;
+    bool pruned = false;
+    if (!showAll) {
+        QMutexLocker locker(&m_refinementMutex);
+        if (m_refinement.valid && m_refinement.generation == snapshot->generation && refinesQuery(searchQuery.text, m_refinement.searchText)
+            && refinesQuery(fullQuery.text, m_refinement.fullText)) {
+            candidates = m_refinement.survivors;
+            pruned = true;
+        }
+    }
+    if (!showAll && !pruned) {
+        pruned = snapshot->searchIndex.collectCandidates({&searchQuery, &fullQuery}, candidates);
+    }
+    QHash<int, double> boosts;
+    if (const std::shared_ptr<const QHash<QString, double>> frecency = m_frecency.load()) {
+        for (auto it = frecency->cbegin(); it != frecency->cend(); ++it) {
+            const int slot = snapshot->slotById.value(it.key(), -1);
+            if (slot >= 0) {
+                boosts.insert(slot, it.value());
+            }
         }
     }
-    const bool showAll = searchPattern.isEmpty();
 
-    for (const SshTarget &target : std::as_const(m_targets)) {
-        double relevance = 0.3;
+    const qsizetype candidateCount = pruned ? candidates.size() : targets.size();
+    const qsizetype resultLimit = snapshot->maxResults > 0 ? snapshot->maxResults : targets.size();
+    QVector<int> survivors;
+    // Min-heap on relevance: the weakest kept result sits on top and is the one evicted.
+    QVector<ScoredTarget> best;
+    best.reserve(qMin(resultLimit, candidateCount));
+    const auto offer = [&best, resultLimit](const ScoredTarget &scored) {
+        if (best.size() < resultLimit) {
+            best.push_back(scored);
+            std::push_heap(best.begin(), best.end(), rankedBefore);
+            return true;
+        }
+        if (rankedBefore(scored, best.constFirst())) {
+            std::pop_heap(best.begin(), best.end(), rankedBefore);
+            best.last() = scored;
+            std::push_heap(best.begin(), best.end(), rankedBefore);
+            return true;
+        }
+        return false;
+    };
+
+    for (qsizetype i = 0; i < candidateCount; ++i) {
+        if (i % s_cancellationCheckInterval == 0 && i > 0 && !context.isValid()) {
+            const int aborted = m_abortedQueries.fetchAndAddRelaxed(1) + 1;
+            qCDebug(LOG_SSHHELPER) << "Abandoned stale query after" << i << "of" << candidateCount << "targets; aborted" << aborted << "completed"
+                                   << m_completedQueries.loadRelaxed();
+            return;
+        }
+        const int slot = pruned ? candidates.at(i) : snapshot->order.at(i);
+        double relevance = 0.33;
         if (!showAll) {
-            const double onLabel = computeFuzzyScore(target.label, searchPattern);
-            const double onArguments = computeFuzzyScore(target.sshArguments.join(QLatin1Char(' ')), searchPattern);
-            const double onDescription = computeFuzzyScore(target.description, searchPattern);
-            const double onDefaultLabel = target.label == target.defaultLabel ? 0.0 : computeFuzzyScore(target.defaultLabel, searchPattern);
-            const double onDnsName = computeFuzzyScore(target.dnsName, searchPattern);
-            const double onUserName = computeFuzzyScore(target.userName, searchPattern);
-            const double onUserHost = target.userName.isEmpty() ? 0.0 : computeFuzzyScore(QStringLiteral("%1@%2").arg(target.userName, target.hostName), pattern);
+            using Table = SshHelper::TargetTable;
+            const double onLabel = SshHelper::fuzzyScore(targets.field(slot, Table::LabelField), searchQuery);
+            const double onArguments = SshHelper::fuzzyScore(targets.field(slot, Table::ArgumentsField), searchQuery);
+            const double onDescription = SshHelper::fuzzyScore(targets.field(slot, Table::DescriptionField), searchQuery);
+            const double onDefaultLabel = SshHelper::fuzzyScore(targets.field(slot, Table::DefaultLabelField), searchQuery);
+            const double onDnsName = SshHelper::fuzzyScore(targets.field(slot, Table::DnsNameField), searchQuery);
+            const double onUserName = SshHelper::fuzzyScore(targets.field(slot, Table::UserNameField), searchQuery);
+            const double onUserHost = SshHelper::fuzzyScore(targets.field(slot, Table::UserHostField), fullQuery);
             relevance = std::max({onLabel, onArguments, onDescription, onDefaultLabel, onDnsName, onUserName, onUserHost});
             if (relevance <= 0.0) {
                 continue;
             }
+            survivors.push_back(slot);
         }
+        // Filters are applied after recording survivors so the refinement cache stays filter independent.
+        if (!passesFilters(slot)) {
+            continue;
+        }
+        if (!boosts.isEmpty()) {
+            relevance += s_frecencyWeight * boosts.value(slot);
+        }
+
+        if (!offer({qBound(0.0, relevance, 1.0), snapshot->rankBySlot.at(slot), slot}) && showAll && boosts.isEmpty()) {
+            // Every target ranks the same, so nothing later can displace what is kept.
+            break;
+        }
+    }
 
+    // Typo tier: only when the regular tiers came up nearly empty, so the common path never pays for it.
+    const int maxTypos = qMin(2, int((searchQuery.text.size() - 1) / 3));
+    if (!showAll && maxTypos > 0 && best.size() < s_typoFallbackThreshold) {
+        const SshHelper::ApproximatePattern typoPattern = SshHelper::compileApproximatePattern(searchQuery.text);
+        QVector<bool> matched(targets.size(), false);
+        for (const int slot : std::as_const(survivors)) {
+            matched[slot] = true;
+        }
+        for (qsizetype i = 0; typoPattern.size > 0 && i < snapshot->order.size(); ++i) {
+            if (i % s_cancellationCheckInterval == 0 && i > 0 && !context.isValid()) {
+                const int aborted = m_abortedQueries.fetchAndAddRelaxed(1) + 1;
+                qCDebug(LOG_SSHHELPER) << "Abandoned stale query during the typo pass; aborted" << aborted << "completed" << m_completedQueries.loadRelaxed();
+                return;
+            }
+            const int slot = snapshot->order.at(i);
+            if (matched.at(slot) || !passesFilters(slot)) {
+                continue;
+            }
+            int distance = -1;
+            for (const auto field : {SshHelper::TargetTable::LabelField, SshHelper::TargetTable::ArgumentsField, SshHelper::TargetTable::DnsNameField}) {
+                const int fieldDistance = SshHelper::approximateDistance(targets.field(slot, field), typoPattern, distance < 0 ? maxTypos : distance - 1);
+                if (fieldDistance >= 0) {
+                    distance = fieldDistance;
+                }
+            }
+            if (distance < 0) {
+                continue;
+            }
+            double relevance = distance <= 1 ? 0.25 : 0.15;
+            if (!boosts.isEmpty()) {
+                relevance += s_frecencyWeight * boosts.value(slot);
+            }
+            offer({relevance, targets.size() + i, slot});
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end(), rankedBefore);
+    QList<KRunner::QueryMatch> matches;
+    matches.reserve(best.size());
+    for (const ScoredTarget &scored : std::as_const(best)) {
+        const int slot = scored.slot;
+        const QString &description = targets.description(slot);
+        const QString &dnsName = targets.dnsName(slot);
         KRunner::QueryMatch match(this);
-        match.setId(target.id);
+        match.setId(targets.id(slot));
         match.setIconName(QStringLiteral("utilities-terminal"));
-        match.setText(target.label);
-        if (target.dnsName.isEmpty()) {
-            match.setSubtext(target.description);
-        } else if (target.description.isEmpty()) {
-            match.setSubtext(i18n("DNS: %1", target.dnsName));
+        match.setText(targets.label(slot));
+        if (dnsName.isEmpty()) {
+            match.setSubtext(description);
+        } else if (description.isEmpty()) {
+            match.setSubtext(i18n("DNS: %1", dnsName));
         } else {
-            match.setSubtext(i18n("%1 (DNS: %2)", target.description, target.dnsName));
+            match.setSubtext(i18n("%1 (DNS: %2)", description, dnsName));
         }
-        match.setRelevance(qBound(0.0, showAll ? qMax(relevance, 0.33) : relevance, 1.0));
+        match.setRelevance(scored.relevance);
         if (showAll) {
             match.setCategoryRelevance(KRunner::QueryMatch::CategoryRelevance::Moderate);
         }
-        QStringList matchArguments = target.sshArguments;
-        if (!explicitUser.isEmpty()) {
-            matchArguments = applyUserToArguments(matchArguments, explicitUser);
-        }
-        match.setData(matchArguments);
-        context.addMatch(match);
+        match.setData(argumentsForMatch(targets.sshArguments(slot), targets.hostArgument(slot), hostQuery));
+        matches.push_back(std::move(match));
     }
+    context.addMatches(matches);
+
+    if (!showAll) {
+        QMutexLocker locker(&m_refinementMutex);
+        m_refinement.generation = snapshot->generation;
+        m_refinement.searchText = searchQuery.text;
+        m_refinement.fullText = fullQuery.text;
+        m_refinement.survivors = std::move(survivors);
+        m_refinement.valid = true;
+    }
+
+    const int completed = m_completedQueries.fetchAndAddRelaxed(1) + 1;
+    qCDebug(LOG_SSHHELPER) << "Scored" << candidateCount << "of" << targets.size() << "targets, kept" << best.size() << "in" << timer.nsecsElapsed() / 1000
+                           << "us; aborted" << m_abortedQueries.loadRelaxed() << "completed" << completed;
 }
 
 void SshHelperRunner::run(const KRunner::RunnerContext &, const KRunner::QueryMatch &match)
 {
+    Launch launch{*m_launcher, {}};
+    launch.sinceRun.start();
     const QStringList arguments = match.data().toStringList();
     if (arguments.isEmpty()) {
         qCWarning(LOG_SSHHELPER) << "No ssh arguments were stored for match" << match.id();
         return;
     }
 
-    if (launchPreferredTerminal(arguments)) {
+    if (!m_history.record(match.id())) {
+        qCWarning(LOG_SSHHELPER) << "Could not record the launch in" << SshHelper::LaunchHistory::defaultFilePath();
+    }
+    publishFrecency();
+
+    const std::shared_ptr<const HostSnapshot> snapshot = m_snapshot.load();
+    if (snapshot && launchPreferredTerminal(*m_launcher, launch.sinceRun, snapshot->terminal, arguments)) {
         return;
     }
 
     const QString sshHelperEnv = qEnvironmentVariable("SSH_HELPER_TERMINAL");
-    if (launchWithCustomDescriptor(sshHelperEnv, arguments)) {
+    if (launchWithCustomDescriptor(launch, sshHelperEnv, arguments)) {
         return;
     }
 
     const QString terminalEnv = qEnvironmentVariable("TERMINAL");
-    if (launchWithCustomDescriptor(terminalEnv, arguments)) {
+    if (launchWithCustomDescriptor(launch, terminalEnv, arguments)) {
         return;
     }
 
-    if (launchWithDashE(QStringLiteral("konsole"), arguments, {QStringLiteral("--noclose")})) {
+    if (launchWithDashE(launch, QStringLiteral("konsole"), arguments, {QStringLiteral("--noclose")})) {
         return;
     }
 
-    if (launchWithDoubleDash(QStringLiteral("gnome-terminal"), arguments)) {
+    if (launchWithDoubleDash(launch, QStringLiteral("gnome-terminal"), arguments)) {
         return;
     }
 
-    if (launchWithDoubleDash(QStringLiteral("kgx"), arguments)) {
+    if (launchWithDoubleDash(launch, QStringLiteral("kgx"), arguments)) {
         return;
     }
 
-    if (launchWithDashE(QStringLiteral("x-terminal-emulator"), arguments)) {
+    if (launchWithDashE(launch, QStringLiteral("x-terminal-emulator"), arguments)) {
         return;
     }
 
@@ -266,74 +460,188 @@ void SshHelperRunner::run(const KRunner::RunnerContext &, const KRunner::QueryMa
     };
 
     for (const QString &terminal : dashETerminals) {
-        if (launchWithDashE(terminal, arguments)) {
+        if (launchWithDashE(launch, terminal, arguments)) {
             return;
         }
     }
 
-    if (launchWithDashE(QStringLiteral("xterm"), arguments, {QStringLiteral("-hold")})) {
+    if (launchWithDashE(launch, QStringLiteral("xterm"), arguments, {QStringLiteral("-hold")})) {
         return;
     }
 
-    if (!QProcess::startDetached(QStringLiteral("ssh"), arguments)) {
+    const QString ssh = SshHelper::findExecutable(QStringLiteral("ssh"));
+    if (ssh.isEmpty() || !startProcess(launch, QStringLiteral("ssh"), ssh, arguments)) {
         qCWarning(LOG_SSHHELPER) << "Failed to start ssh client for" << match.id();
     }
 }
 
+void SshHelperRunner::watchedFileChanged(const QString &path)
+{
+    const QString homePath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+    if (!homePath.isEmpty() && path == QDir(homePath).filePath(QStringLiteral(".ssh/known_hosts"))) {
+        scheduleSourceReload(KnownHostsSource);
+    } else if (path == SshHelper::configFilePath()) {
+        scheduleSourceReload(SettingsSource);
+    } else {
+        scheduleSourceReload(ConfigSource);
+    }
+}
+
+void SshHelperRunner::watchedDirectoryChanged()
+{
+    // A file appeared or vanished in ~/.ssh or an Include directory; unchanged files are skipped by their stamps.
+    scheduleSourceReload({ConfigSource, KnownHostsSource});
+}
+
+void SshHelperRunner::settingsChanged()
+{
+    scheduleSourceReload(SettingsSource);
+}
+
 void SshHelperRunner::scheduleReload()
 {
-    m_loaded = false;
+    scheduleSourceReload(AllSources);
+}
+
+void SshHelperRunner::scheduleSourceReload(ReloadSources sources)
+{
+    m_pendingSources.fetchAndOrRelaxed(sources.toInt());
     if (!m_reloadTimer.isActive()) {
         m_reloadTimer.start();
     }
 }
 
-void SshHelperRunner::ensureHostsLoaded()
+void SshHelperRunner::publishFrecency()
 {
-    if (!m_loaded) {
-        reloadHosts();
+    auto boosts = std::make_shared<QHash<QString, double>>(m_history.scores());
+    for (double &boost : *boosts) {
+        boost = boost / (boost + s_frecencySaturation);
     }
+    m_frecency.store(std::move(boosts));
 }
 
-QString SshHelperRunner::normalized(const QString &text)
+std::shared_ptr<const SshHelperRunner::HostSnapshot> SshHelperRunner::ensureHostsLoaded()
 {
-    QString simplified = text.simplified();
-    return simplified.toCaseFolded();
+    std::shared_ptr<const HostSnapshot> snapshot = m_snapshot.load();
+    if (snapshot) {
+        return snapshot;
+    }
+
+    QMutexLocker locker(&m_reloadMutex);
+    snapshot = m_snapshot.load();
+    if (!snapshot) {
+        if (!loadPersistedSnapshot()) {
+            reloadHostsLocked();
+        }
+        snapshot = m_snapshot.load();
+    }
+    return snapshot;
 }
 
-double SshHelperRunner::computeFuzzyScore(const QString &candidate, const QString &pattern)
+QStringList SshHelperRunner::sourcePaths()
 {
-    const QString candidateNorm = normalized(candidate);
-    const QString patternNorm = normalized(pattern);
+    const QString homePath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+    const QString helperConfig = SshHelper::configFilePath();
+    if (homePath.isEmpty() || helperConfig.isEmpty()) {
+        return {};
+    }
+    const QDir sshDir(QDir(homePath).filePath(QStringLiteral(".ssh")));
+    return {sshDir.filePath(QStringLiteral("config")), sshDir.filePath(QStringLiteral("known_hosts")), helperConfig};
+}
 
-    if (candidateNorm.isEmpty() || patternNorm.isEmpty()) {
-        return 0.0;
+bool SshHelperRunner::loadPersistedSnapshot()
+{
+    const QStringList paths = sourcePaths();
+    const QString filePath = snapshotFilePath();
+    if (paths.isEmpty() || filePath.isEmpty()) {
+        return false;
     }
 
-    if (candidateNorm == patternNorm) {
-        return 1.0;
+    QElapsedTimer timer;
+    timer.start();
+    std::shared_ptr<HostSnapshot> snapshot = SshHelper::readSnapshotFile(filePath, paths);
+    if (!snapshot) {
+        return false;
     }
+    snapshot->generation = ++m_generation;
+
+    const SshHelper::DnsCacheSettings dnsSettings = SshHelper::loadDnsCacheSettings();
+    m_dnsCache.setTimeToLive(dnsSettings.positiveTtl, dnsSettings.negativeTtl);
+    m_dnsCache.load();
 
-    if (candidateNorm.startsWith(patternNorm)) {
-        const double proximity = static_cast<double>(patternNorm.size()) / static_cast<double>(candidateNorm.size());
-        return qBound(0.0, 0.8 + (0.2 * proximity), 1.0);
+    // Names resolved after the snapshot was written live in the DNS cache.
+    QSet<QString> pendingAddresses;
+    for (int i = 0; i < snapshot->targets.size(); ++i) {
+        const QString &dnsAddress = snapshot->targets.dnsAddress(i);
+        if (dnsAddress.isEmpty() || !snapshot->targets.dnsName(i).isEmpty()) {
+            continue;
+        }
+        QString dnsName;
+        const SshHelper::DnsCache::Status status = m_dnsCache.lookup(dnsAddress, &dnsName);
+        if (status == SshHelper::DnsCache::Status::Resolved) {
+            SshTarget target = snapshot->targets.at(i);
+            target.dnsName = dnsName;
+            buildSearchFields(target);
+            snapshot->searchIndex.addEntry(i, target.search);
+            snapshot->targets.replace(i, target);
+        } else if (status == SshHelper::DnsCache::Status::Unknown) {
+            pendingAddresses.insert(dnsAddress);
+        }
     }
 
-    if (candidateNorm.contains(patternNorm)) {
-        const double proximity = static_cast<double>(patternNorm.size()) / static_cast<double>(candidateNorm.size());
-        return qBound(0.0, 0.6 + (0.2 * proximity), 1.0);
+    const qsizetype count = snapshot->targets.size();
+    m_snapshot.store(std::move(snapshot));
+    QMetaObject::invokeMethod(this, &SshHelperRunner::revalidateSnapshot, Qt::QueuedConnection);
+    if (!pendingAddresses.isEmpty()) {
+        m_dnsResolver->resolve(pendingAddresses.values());
     }
 
-    const QStringList tokens = patternNorm.split(QLatin1Char(' '), Qt::SkipEmptyParts);
-    if (tokens.isEmpty()) {
-        return 0.0;
+    qCDebug(LOG_SSHHELPER) << "Loaded persisted snapshot with" << count << "targets in" << timer.nsecsElapsed() / 1000 << "us";
+    return true;
+}
+
+void SshHelperRunner::revalidateSnapshot()
+{
+    const QStringList paths = sourcePaths();
+    if (paths.isEmpty()) {
+        return;
+    }
+    // Anything that changed between the stamp check and the watcher being armed is caught here.
+    const std::shared_ptr<const HostSnapshot> snapshot = m_snapshot.load();
+    if (!snapshot) {
+        scheduleReload();
+        return;
     }
+    updateWatchedPaths(QFileInfo(paths.at(0)).absolutePath(), paths.at(0), paths.at(1), snapshot->configIncludes);
+    if (snapshot->sourceKey != SshHelper::sourceStampKey(paths) + SshHelper::fileStamps(snapshot->configIncludes)) {
+        scheduleReload();
+    }
+}
 
-    double total = 0.0;
-    for (const QString &token : tokens) {
-        total += subsequenceScore(candidateNorm, token);
+void SshHelperRunner::persistSnapshot(const std::shared_ptr<const HostSnapshot> &snapshot)
+{
+    const QString filePath = snapshotFilePath();
+    if (filePath.isEmpty() || snapshot->sourceKey.isEmpty()) {
+        return;
     }
-    return qBound(0.0, total / tokens.size(), 1.0);
+
+    m_persistPool.start([filePath, snapshot]() {
+        if (!SshHelper::writeSnapshotFile(filePath, *snapshot)) {
+            qCWarning(LOG_SSHHELPER) << "Could not write the host snapshot to" << filePath;
+        }
+    });
+}
+
+void SshHelperRunner::buildSearchFields(SshTarget &target)
+{
+    SshHelper::SearchFields &search = target.search;
+    search.label = SshHelper::searchField(target.label);
+    search.arguments = SshHelper::searchField(target.sshArguments.join(QLatin1Char(' ')));
+    search.description = SshHelper::searchField(target.description);
+    search.defaultLabel = target.label == target.defaultLabel ? SshHelper::SearchField() : SshHelper::searchField(target.defaultLabel);
+    search.dnsName = SshHelper::searchField(target.dnsName);
+    search.userName = SshHelper::searchField(target.userName);
+    search.userHost = target.userName.isEmpty() ? SshHelper::SearchField() : SshHelper::searchField(QStringLiteral("%1@%2").arg(target.userName, target.hostName));
 }
 
 QString SshHelperRunner::hostFromArguments(const QStringList &arguments)
@@ -484,6 +792,29 @@ int SshHelperRunner::hostArgumentIndex(const QStringList &arguments)
     return candidateIndex;
 }
 
+QStringList SshHelperRunner::argumentsForMatch(const QStringList &sshArguments, int hostArgument, const SshHelper::HostQuery &query)
+{
+    if (query.user.isEmpty() && query.port < 0) {
+        return sshArguments;
+    }
+
+    QStringList arguments = sshArguments;
+    if (!query.user.isEmpty() && hostArgument >= 0) {
+        QStringView host(arguments.at(hostArgument));
+        const qsizetype atIndex = host.lastIndexOf(QLatin1Char('@'));
+        if (atIndex > 0) {
+            host = host.sliced(atIndex + 1);
+        }
+        arguments[hostArgument] = QStringLiteral("%1@%2").arg(query.user, host);
+    }
+    if (query.port > 0) {
+        // ssh keeps the first -p it sees, so the typed port goes in front.
+        arguments.prepend(QString::number(query.port));
+        arguments.prepend(QStringLiteral("-p"));
+    }
+    return arguments;
+}
+
 QStringList SshHelperRunner::applyUserToArguments(const QStringList &arguments, const QString &userName)
 {
     if (userName.trimmed().isEmpty() || arguments.isEmpty()) {
@@ -510,247 +841,592 @@ QStringList SshHelperRunner::applyUserToArguments(const QStringList &arguments,
     return updated;
 }
 
-QString SshHelperRunner::normalizedHost(const QString &host)
+void SshHelperRunner::reloadHosts()
 {
-    QString candidate = host.trimmed();
-    if (candidate.isEmpty()) {
-        return {};
+    QMutexLocker locker(&m_reloadMutex);
+    reloadHostsLocked();
+}
+
+void SshHelperRunner::startBackgroundReload()
+{
+    // Events arriving while a reload runs only add to m_pendingSources; the running one picks them up.
+    if (m_reloadInFlight.testAndSetAcquire(0, 1)) {
+        m_reloadPool.start([this]() {
+            backgroundReload();
+        });
     }
+}
 
-    const int atIndex = candidate.lastIndexOf(QLatin1Char('@'));
-    if (atIndex >= 0) {
-        candidate = candidate.mid(atIndex + 1);
+void SshHelperRunner::backgroundReload()
+{
+    do {
+        QElapsedTimer timer;
+        timer.start();
+        reloadHosts();
+        qCDebug(LOG_SSHHELPER) << "Background reload finished in" << timer.elapsed() << "ms";
+        m_reloadInFlight.storeRelease(0);
+    } while (m_pendingSources.loadRelaxed() != 0 && m_reloadInFlight.testAndSetAcquire(0, 1));
+}
+
+void SshHelperRunner::reloadHostsLocked()
+{
+    // Slices never parsed by this process, e.g. after starting from the persisted snapshot, are always read.
+    const ReloadSources sources = ReloadSources::fromInt(m_pendingSources.fetchAndStoreRelaxed(0)) | (ReloadSources(AllSources) & ~m_parsedSources);
+
+    const QString homePath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
+    if (homePath.isEmpty()) {
+        qCWarning(LOG_SSHHELPER) << "Could not resolve the user's home directory.";
+        auto snapshot = std::make_shared<HostSnapshot>();
+        snapshot->generation = ++m_generation;
+        snapshot->terminal.id = QStringLiteral("auto");
+        m_snapshot.store(std::move(snapshot));
+        return;
     }
 
-    if (candidate.startsWith(QLatin1Char('['))) {
-        const int closeIndex = candidate.indexOf(QLatin1Char(']'));
-        if (closeIndex > 1) {
-            candidate = candidate.mid(1, closeIndex - 1);
+    const QString sshDirPath = QDir(homePath).filePath(QStringLiteral(".ssh"));
+    const QString configPath = QDir(sshDirPath).filePath(QStringLiteral("config"));
+    const QString knownHostsPath = QDir(sshDirPath).filePath(QStringLiteral("known_hosts"));
+    // Stamped before parsing so a write racing with the reload leaves a stale key, not stale content.
+    const QStringList paths = sourcePaths();
+    const QByteArray baseKey = paths.isEmpty() ? QByteArray() : SshHelper::sourceStampKey(paths);
+
+    const std::shared_ptr<const HostSnapshot> current = m_snapshot.load();
+    bool rebuild = !current;
+    bool appended = false;
+    bool settingsPatched = false;
+    QStringList timings;
+    QElapsedTimer timer;
+
+    if (sources.testFlag(SettingsSource)) {
+        timer.start();
+        if (!reloadSettings()) {
+            rebuild = true;
+        }
+        settingsPatched = true;
+        timings << QStringLiteral("settings %1 ms").arg(timer.elapsed());
+    }
+
+    if (sources.testFlag(ConfigSource)) {
+        timer.start();
+        const QByteArray stamps = SshHelper::fileStamps(QStringList{configPath} + m_configIncludes);
+        if (!m_parsedSources.testFlag(ConfigSource) || stamps != m_configStamps) {
+            QStringList includes;
+            m_configHosts = SshHelper::discoverConfigHosts(configPath, &includes);
+            m_configIncludes = includes;
+            m_configStamps = SshHelper::fileStamps(QStringList{configPath} + includes);
+            rebuild = true;
+            timings << QStringLiteral("config %1 ms").arg(timer.elapsed());
         }
     }
 
-    const int scopeIndex = candidate.indexOf(QLatin1Char('%'));
-    if (scopeIndex > 0) {
-        candidate = candidate.left(scopeIndex);
+    if (sources.testFlag(KnownHostsSource)) {
+        timer.start();
+        const qsizetype hostCount = m_knownHosts.hosts().size();
+        const qsizetype hashedCount = m_knownHosts.hashedHosts().size();
+        if (!m_knownHosts.update(knownHostsPath)) {
+            rebuild = true;
+        } else {
+            appended = m_knownHosts.hosts().size() != hostCount || m_knownHosts.hashedHosts().size() != hashedCount;
+        }
+        timings << QStringLiteral("known_hosts %1 ms").arg(timer.elapsed());
     }
+    m_parsedSources |= sources;
 
-    if (candidate.endsWith(QLatin1Char('.'))) {
-        candidate.chop(1);
-    }
+    const QByteArray sourceKey = baseKey.isEmpty() ? QByteArray() : baseKey + SshHelper::fileStamps(m_configIncludes);
+    QMetaObject::invokeMethod(this, [this, sshDirPath, configPath, knownHostsPath, includes = m_configIncludes]() {
+        updateWatchedPaths(sshDirPath, configPath, knownHostsPath, includes);
+    });
 
-    return candidate;
+    timer.start();
+    if (rebuild || (appended && settingsPatched)) {
+        assembleSnapshot(sourceKey);
+        timings << QStringLiteral("assembly %1 ms").arg(timer.elapsed());
+    } else if (appended) {
+        appendKnownHosts(*current, sourceKey);
+        timings << QStringLiteral("append %1 ms").arg(timer.elapsed());
+    } else if (settingsPatched) {
+        patchSettings(*current, sourceKey);
+        timings << QStringLiteral("label patch %1 ms").arg(timer.elapsed());
+    } else if (current->sourceKey != sourceKey) {
+        // Touched without a content change: only the stamps of the persisted copy are refreshed.
+        auto updated = std::make_shared<HostSnapshot>(*current);
+        updated->sourceKey = sourceKey;
+        persistSnapshot(updated);
+        m_snapshot.store(std::move(updated));
+    }
+
+    QStringList sourceNames;
+    if (sources.testFlag(ConfigSource)) {
+        sourceNames << QStringLiteral("config");
+    }
+    if (sources.testFlag(KnownHostsSource)) {
+        sourceNames << QStringLiteral("known_hosts");
+    }
+    if (sources.testFlag(SettingsSource)) {
+        sourceNames << QStringLiteral("settings");
+    }
+    qCDebug(LOG_SSHHELPER) << "Reloaded" << sourceNames.join(QStringLiteral(", ")) << "-"
+                           << (timings.isEmpty() ? QStringLiteral("unchanged") : timings.join(QStringLiteral(", ")));
 }
 
-QString SshHelperRunner::resolveDnsNameForHost(const QString &host)
+bool SshHelperRunner::reloadSettings()
 {
-    const QString normalized = normalizedHost(host);
-    if (normalized.isEmpty()) {
-        return {};
+    const SshHelper::DnsCacheSettings dnsSettings = SshHelper::loadDnsCacheSettings();
+    m_dnsCache.setTimeToLive(dnsSettings.positiveTtl, dnsSettings.negativeTtl);
+    m_dnsCache.load();
+
+    const SshHelper::TerminalPreference terminalPref = SshHelper::loadTerminalPreference();
+    m_terminal.id = terminalPref.id.isEmpty() ? QStringLiteral("auto") : terminalPref.id;
+    m_terminal.customCommand = terminalPref.customCommand.trimmed();
+    m_maxResults = SshHelper::loadSearchSettings().maxResults;
+    m_customLabels = SshHelper::loadCustomLabels();
+
+    QHash<QString, QString> usernames = SshHelper::loadCustomUsernames();
+    QVector<SshHelper::ManualEntry> manualEntries = SshHelper::loadManualEntries();
+    const bool resolveHashed = SshHelper::loadKnownHostsSettings().resolveHashed;
+    const bool patchable = m_parsedSources.testFlag(SettingsSource) && usernames == m_customUsernames && manualEntries == m_manualEntries
+        && resolveHashed == m_resolveHashedHosts;
+    m_customUsernames = std::move(usernames);
+    m_manualEntries = std::move(manualEntries);
+    m_resolveHashedHosts = resolveHashed;
+    return patchable;
+}
+
+void SshHelperRunner::assembleSnapshot(const QByteArray &sourceKey)
+{
+    auto snapshot = std::make_shared<HostSnapshot>();
+    snapshot->generation = ++m_generation;
+    snapshot->terminal = m_terminal;
+    snapshot->maxResults = m_maxResults;
+    snapshot->configIncludes = m_configIncludes;
+    snapshot->sourceKey = sourceKey;
+
+    // Rows are assembled and sorted here, then moved into the column store in display order.
+    QVector<SshTarget> targets;
+    // Every source merges through this map, so the first source to name an id owns its row.
+    QHash<QString, qsizetype> rowById;
+    const QVector<SshHelper::DiscoveredHost> &knownHosts = m_knownHosts.hosts();
+    targets.reserve(m_configHosts.size() + knownHosts.size() + m_manualEntries.size());
+    rowById.reserve(targets.capacity());
+    const auto addDiscovered = [this, &targets, &rowById](const SshHelper::DiscoveredHost &host) {
+        if (rowById.contains(host.id)) {
+            return;
+        }
+        rowById.insert(host.id, targets.size());
+        targets.push_back(makeDiscoveredTarget(host));
+    };
+
+    for (const SshHelper::DiscoveredHost &host : std::as_const(m_configHosts)) {
+        addDiscovered(host);
+    }
+    for (const SshHelper::DiscoveredHost &host : knownHosts) {
+        addDiscovered(host);
     }
 
-    QString ipCandidate = normalized;
-    QHostAddress address;
-    if (!address.setAddress(ipCandidate)) {
-        if (ipCandidate.count(QLatin1Char(':')) == 1 && ipCandidate.contains(QLatin1Char('.'))) {
-            const QString stripped = ipCandidate.section(QLatin1Char(':'), 0, 0);
-            if (!address.setAddress(stripped)) {
-                return {};
-            }
-            ipCandidate = stripped;
+    for (const SshHelper::ManualEntry &manual : std::as_const(m_manualEntries)) {
+        if (manual.id.isEmpty() || manual.arguments.isEmpty()) {
+            continue;
+        }
+
+        SshTarget entry;
+        entry.id = manual.id;
+        entry.defaultLabel = manual.name.isEmpty() ? manual.id : manual.name;
+        entry.label = entry.defaultLabel;
+        entry.description = manual.description.isEmpty() ? i18n("Manual entry") : manual.description;
+        entry.sshArguments = manual.arguments;
+        entry.hostName = hostFromArguments(entry.sshArguments);
+        entry.userName.clear();
+        entry.origin = SshHelper::EntryOrigin::Manual;
+        entry.isManual = true;
+
+        const auto existing = rowById.constFind(entry.id);
+        if (existing != rowById.cend()) {
+            // A manual entry replaces the discovered host with the same id.
+            targets[*existing] = std::move(entry);
         } else {
-            return {};
+            rowById.insert(entry.id, targets.size());
+            targets.push_back(std::move(entry));
+        }
+    }
+
+    // Hashed entries are matched against these once the plain snapshot is out, see mergeHashedHosts().
+    m_hashCandidates.clear();
+    if (m_resolveHashedHosts) {
+        for (const SshHelper::DiscoveredHost &host : std::as_const(m_configHosts)) {
+            SshHelper::addHashedHostNames(m_hashCandidates, host.alias, host.port);
+            SshHelper::addHashedHostNames(m_hashCandidates, host.hostName, host.port);
+        }
+        for (const SshHelper::DiscoveredHost &host : knownHosts) {
+            SshHelper::addHashedHostNames(m_hashCandidates, host.alias);
+        }
+        for (const SshTarget &target : std::as_const(targets)) {
+            if (target.isManual) {
+                SshHelper::addHashedHostNames(m_hashCandidates, target.hostName, portFromArguments(target.sshArguments));
+            }
         }
     }
 
-    if (m_dnsCache.contains(ipCandidate)) {
-        return m_dnsCache.value(ipCandidate);
+    QSet<QString> pendingAddresses;
+    for (SshTarget &target : targets) {
+        finalizeTarget(target, pendingAddresses);
     }
-    if (m_dnsFailures.contains(ipCandidate)) {
-        return {};
+
+    // Each label is collated once; the sort itself only compares keys.
+    std::vector<QCollatorSortKey> sortKeys;
+    sortKeys.reserve(targets.size());
+    for (const SshTarget &target : std::as_const(targets)) {
+        sortKeys.push_back(m_collator.sortKey(target.label));
     }
+    QVector<int> rows(targets.size());
+    std::iota(rows.begin(), rows.end(), 0);
+    std::stable_sort(rows.begin(), rows.end(), [&sortKeys](int lhs, int rhs) {
+        return sortKeys[lhs].compare(sortKeys[rhs]) < 0;
+    });
 
-    const QHostInfo info = QHostInfo::fromName(ipCandidate);
-    if (info.error() != QHostInfo::NoError) {
-        m_dnsFailures.insert(ipCandidate);
-        return {};
+    snapshot->targets.reserve(targets.size());
+    snapshot->sortKeys.reserve(targets.size());
+    snapshot->slotById.reserve(targets.size());
+    snapshot->order.reserve(targets.size());
+    for (const int row : std::as_const(rows)) {
+        const SshTarget &target = targets.at(row);
+        const int slot = snapshot->targets.append(target);
+        snapshot->sortKeys.push_back(sortKeys[row]);
+        snapshot->searchIndex.addEntry(slot, target.search);
+        snapshot->slotById.insert(target.id, slot);
+        snapshot->order.push_back(slot);
     }
+    SshHelper::updateRanks(*snapshot);
+
+    persistSnapshot(snapshot);
+    m_snapshot.store(std::move(snapshot));
 
-    QString resolved = info.hostName().trimmed();
-    if (resolved.endsWith(QLatin1Char('.'))) {
-        resolved.chop(1);
+    if (!pendingAddresses.isEmpty()) {
+        m_dnsResolver->resolve(pendingAddresses.values());
     }
+    queueHashedHostMerge();
+}
 
-    if (resolved.isEmpty() || resolved == ipCandidate) {
-        m_dnsFailures.insert(ipCandidate);
-        return {};
+SshHelperRunner::SshTarget SshHelperRunner::makeDiscoveredTarget(const SshHelper::DiscoveredHost &host) const
+{
+    SshTarget entry;
+    entry.id = host.id;
+    entry.defaultLabel = host.alias;
+    entry.label = host.alias;
+    const QString customLabel = m_customLabels.value(entry.id).trimmed();
+    if (!customLabel.isEmpty()) {
+        entry.label = customLabel;
+    }
+    entry.description = host.description;
+    entry.userName = host.userName.trimmed();
+    const QString customUser = m_customUsernames.value(entry.id).trimmed();
+    if (!customUser.isEmpty()) {
+        entry.userName = customUser;
+    }
+    entry.sshArguments = host.arguments;
+    if (!entry.userName.isEmpty()) {
+        entry.sshArguments = applyUserToArguments(entry.sshArguments, entry.userName);
+    }
+    entry.hostName = host.hostName.isEmpty() ? host.alias : host.hostName;
+    entry.origin = host.origin;
+    return entry;
+}
+
+void SshHelperRunner::finalizeTarget(SshTarget &target, QSet<QString> &pendingAddresses)
+{
+    if (target.hostName.isEmpty()) {
+        target.hostName = hostFromArguments(target.sshArguments);
     }
+    if (target.hostName.isEmpty()) {
+        target.hostName = target.defaultLabel;
+    }
+    target.hostArgument = hostArgumentIndex(target.sshArguments);
+    target.dnsAddress = SshHelper::reverseLookupAddress(target.hostName);
+    if (!target.dnsAddress.isEmpty()) {
+        if (m_dnsCache.lookup(target.dnsAddress, &target.dnsName) == SshHelper::DnsCache::Status::Unknown) {
+            pendingAddresses.insert(target.dnsAddress);
+        }
+    }
+    buildSearchFields(target);
+}
 
-    QHostAddress resolvedAddress;
-    if (resolvedAddress.setAddress(resolved)) {
-        m_dnsFailures.insert(ipCandidate);
-        return {};
+void SshHelperRunner::appendKnownHosts(const HostSnapshot &current, const QByteArray &sourceKey)
+{
+    const QVector<SshHelper::DiscoveredHost> &parsed = m_knownHosts.hosts();
+    const QVector<SshHelper::DiscoveredHost> hosts = parsed.mid(m_knownHosts.appendedFrom());
+    if (m_resolveHashedHosts) {
+        for (const SshHelper::DiscoveredHost &host : hosts) {
+            SshHelper::addHashedHostNames(m_hashCandidates, host.alias);
+        }
     }
 
-    m_dnsCache.insert(ipCandidate, resolved);
-    return resolved;
+    const qsizetype appended = appendDiscoveredHosts(current, hosts, sourceKey);
+    qCDebug(LOG_SSHHELPER) << "Parsed appended known_hosts lines, added" << appended << "targets";
+    queueHashedHostMerge();
 }
-void SshHelperRunner::reloadHosts()
+
+qsizetype SshHelperRunner::appendDiscoveredHosts(const HostSnapshot &current, const QVector<SshHelper::DiscoveredHost> &hosts, const QByteArray &sourceKey)
 {
-    const QString homePath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
-    if (homePath.isEmpty()) {
-        qCWarning(LOG_SSHHELPER) << "Could not resolve the user's home directory.";
-        m_targets.clear();
-        m_seenIds.clear();
-        m_loaded = true;
-        return;
+    std::shared_ptr<HostSnapshot> updated;
+    QSet<QString> pendingAddresses;
+
+    for (const SshHelper::DiscoveredHost &host : hosts) {
+        if (current.slotById.contains(host.id) || (updated && updated->slotById.contains(host.id))) {
+            continue;
+        }
+        if (!updated) {
+            updated = std::make_shared<HostSnapshot>(current);
+            updated->generation = ++m_generation;
+            updated->sourceKey = sourceKey;
+        }
+
+        SshTarget target = makeDiscoveredTarget(host);
+        finalizeTarget(target, pendingAddresses);
+        const int slot = updated->targets.append(target);
+        insertIntoOrder(*updated, slot);
+        updated->slotById.insert(target.id, slot);
+        updated->searchIndex.addEntry(slot, target.search);
     }
 
-    const QString sshDirPath = QDir(homePath).filePath(QStringLiteral(".ssh"));
-    const QString configPath = QDir(sshDirPath).filePath(QStringLiteral("config"));
-    const QString knownHostsPath = QDir(sshDirPath).filePath(QStringLiteral("known_hosts"));
+    const qsizetype appended = updated ? updated->targets.size() - current.targets.size() : 0;
+    if (updated) {
+        SshHelper::updateRanks(*updated);
+        persistSnapshot(updated);
+        m_snapshot.store(std::move(updated));
+    }
+    if (!pendingAddresses.isEmpty()) {
+        m_dnsResolver->resolve(pendingAddresses.values());
+    }
+    return appended;
+}
 
-    if (!m_watcher.files().isEmpty()) {
-        m_watcher.removePaths(m_watcher.files());
+void SshHelperRunner::queueHashedHostMerge()
+{
+    // Called with m_reloadMutex held, like the merge itself runs.
+    if (!m_resolveHashedHosts || m_knownHosts.hashedHosts().isEmpty() || m_hashedMergeQueued) {
+        return;
     }
-    if (!m_watcher.directories().isEmpty()) {
-        m_watcher.removePaths(m_watcher.directories());
+    m_hashedMergeQueued = true;
+    m_reloadPool.start([this]() {
+        mergeHashedHosts();
+    });
+}
+
+void SshHelperRunner::mergeHashedHosts()
+{
+    // The HMAC pass runs here, after the plain snapshot was published, so a cold cache never holds up a query.
+    QMutexLocker locker(&m_reloadMutex);
+    m_hashedMergeQueued = false;
+    const std::shared_ptr<const HostSnapshot> current = m_snapshot.load();
+    if (!current || !m_resolveHashedHosts) {
+        return;
     }
+    const qsizetype added = appendDiscoveredHosts(*current, resolveHashedHosts(), current->sourceKey);
+    qCDebug(LOG_SSHHELPER) << "Merged" << added << "hosts recovered from hashed known_hosts entries";
+}
 
-    if (QDir(sshDirPath).exists()) {
-        m_watcher.addPath(sshDirPath);
+void SshHelperRunner::patchSettings(const HostSnapshot &current, const QByteArray &sourceKey)
+{
+    auto updated = std::make_shared<HostSnapshot>(current);
+    updated->terminal = m_terminal;
+    updated->maxResults = m_maxResults;
+    updated->sourceKey = sourceKey;
+
+    updateSortKeys(*updated);
+    QVector<int> relabeled;
+    for (int slot = 0; slot < updated->targets.size(); ++slot) {
+        // Manual entries are named by the entry itself, not by the label overrides.
+        if (updated->targets.isManual(slot)) {
+            continue;
+        }
+        const QString customLabel = m_customLabels.value(updated->targets.id(slot)).trimmed();
+        const QString &label = customLabel.isEmpty() ? updated->targets.defaultLabel(slot) : customLabel;
+        if (label == updated->targets.label(slot)) {
+            continue;
+        }
+        SshTarget target = updated->targets.at(slot);
+        target.label = label;
+        buildSearchFields(target);
+        updated->searchIndex.addEntry(slot, target.search);
+        updated->targets.replace(slot, target);
+        updated->sortKeys[slot] = m_collator.sortKey(label);
+        relabeled.push_back(slot);
+    }
+
+    if (relabeled.size() > updated->order.size() / s_resortFraction) {
+        updated->generation = ++m_generation;
+        std::stable_sort(updated->order.begin(), updated->order.end(), [&updated](int lhs, int rhs) {
+            return updated->sortKeys[lhs].compare(updated->sortKeys[rhs]) < 0;
+        });
+    } else if (!relabeled.isEmpty()) {
+        updated->generation = ++m_generation;
+        QVector<bool> moved(updated->targets.size(), false);
+        for (const int slot : std::as_const(relabeled)) {
+            moved[slot] = true;
+        }
+        updated->order.removeIf([&moved](int slot) {
+            return moved.at(slot);
+        });
+        for (const int slot : std::as_const(relabeled)) {
+            insertIntoOrder(*updated, slot);
+        }
     }
-    if (QFile::exists(configPath)) {
-        m_watcher.addPath(configPath);
+    if (!relabeled.isEmpty()) {
+        SshHelper::updateRanks(*updated);
     }
-    if (QFile::exists(knownHostsPath)) {
-        m_watcher.addPath(knownHostsPath);
+
+    persistSnapshot(updated);
+    m_snapshot.store(std::move(updated));
+    qCDebug(LOG_SSHHELPER) << "Patched" << relabeled.size() << "labels in place";
+}
+
+void SshHelperRunner::insertIntoOrder(HostSnapshot &snapshot, int slot) const
+{
+    updateSortKeys(snapshot);
+    const auto position = std::upper_bound(snapshot.order.begin(), snapshot.order.end(), slot, [&snapshot](int inserted, int other) {
+        return snapshot.sortKeys[inserted].compare(snapshot.sortKeys[other]) < 0;
+    });
+    snapshot.order.insert(position, slot);
+}
+
+void SshHelperRunner::updateSortKeys(HostSnapshot &snapshot) const
+{
+    // Persisted snapshots carry no keys, and appended slots have none yet.
+    snapshot.sortKeys.reserve(snapshot.targets.size());
+    for (int slot = int(snapshot.sortKeys.size()); slot < snapshot.targets.size(); ++slot) {
+        snapshot.sortKeys.push_back(m_collator.sortKey(snapshot.targets.label(slot)));
     }
+}
 
-    const QString helperConfig = SshHelper::configFilePath();
-    if (!helperConfig.isEmpty() && QFile::exists(helperConfig)) {
-        m_watcher.addPath(helperConfig);
+QVector<SshHelper::DiscoveredHost> SshHelperRunner::resolveHashedHosts()
+{
+    if (!m_hashedHostsLoaded) {
+        m_hashedHosts.load();
+        m_hashedHostsLoaded = true;
     }
 
-    m_targets.clear();
-    m_seenIds.clear();
-    m_dnsFailures.clear();
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<SshHelper::HashedKnownHost> &entries = m_knownHosts.hashedHosts();
+    const QVector<SshHelper::DiscoveredHost> hosts = m_hashedHosts.match(entries, m_hashCandidates);
+    if (!m_hashedHosts.save()) {
+        qCWarning(LOG_SSHHELPER) << "Could not write the hashed known_hosts cache to" << SshHelper::HashedHostMatcher::defaultFilePath();
+    }
 
-    m_customLabels = SshHelper::loadCustomLabels();
-    m_customUsernames = SshHelper::loadCustomUsernames();
-    m_manualEntries = SshHelper::loadManualEntries();
+    qCDebug(LOG_SSHHELPER) << "Matched" << hosts.size() << "names against" << entries.size() << "hashed known_hosts entries in" << timer.elapsed() << "ms";
+    return hosts;
+}
 
-    const QVector<SshHelper::DiscoveredHost> discovered = SshHelper::discoverHosts(configPath, knownHostsPath);
-    m_targets.reserve(discovered.size() + m_manualEntries.size());
+void SshHelperRunner::mergeDnsResults(const QHash<QString, QString> &results)
+{
+    // Queued behind any running reload instead of blocking the main thread on its mutex.
+    m_reloadPool.start([this, results]() {
+        applyDnsResults(results);
+    });
+}
 
-    for (const auto &host : discovered) {
-        SshTarget entry;
-        entry.id = host.id;
-        entry.defaultLabel = host.alias;
-        entry.label = host.alias;
-        entry.description = host.description;
-        entry.userName = host.userName.trimmed();
-        const QString customUser = m_customUsernames.value(entry.id).trimmed();
-        if (!customUser.isEmpty()) {
-            entry.userName = customUser;
-        }
-        entry.sshArguments = host.arguments;
-        if (!entry.userName.isEmpty()) {
-            entry.sshArguments = applyUserToArguments(entry.sshArguments, entry.userName);
-        }
-        entry.hostName = host.hostName.isEmpty() ? host.alias : host.hostName;
-        entry.origin = host.origin;
-        m_targets.push_back(entry);
-        m_seenIds.insert(entry.id);
+void SshHelperRunner::applyDnsResults(const QHash<QString, QString> &results)
+{
+    QMutexLocker locker(&m_reloadMutex);
+    for (auto it = results.cbegin(); it != results.cend(); ++it) {
+        m_dnsCache.insert(it.key(), it.value());
+    }
+    if (!m_dnsCache.save()) {
+        qCWarning(LOG_SSHHELPER) << "Could not write the DNS cache to" << SshHelper::DnsCache::defaultFilePath();
     }
 
-    for (SshTarget &target : m_targets) {
-        const QString custom = m_customLabels.value(target.id).trimmed();
-        if (!custom.isEmpty()) {
-            target.label = custom;
-        }
+    const std::shared_ptr<const HostSnapshot> current = m_snapshot.load();
+    if (!current) {
+        return;
     }
 
-    for (const SshHelper::ManualEntry &manual : std::as_const(m_manualEntries)) {
-        if (manual.id.isEmpty() || manual.arguments.isEmpty()) {
+    std::shared_ptr<HostSnapshot> updated;
+    for (int i = 0; i < current->targets.size(); ++i) {
+        const QString &dnsAddress = current->targets.dnsAddress(i);
+        if (dnsAddress.isEmpty() || !current->targets.dnsName(i).isEmpty()) {
             continue;
         }
-
-        SshTarget entry;
-        entry.id = manual.id;
-        entry.defaultLabel = manual.name.isEmpty() ? manual.id : manual.name;
-        entry.label = entry.defaultLabel;
-        entry.description = manual.description.isEmpty() ? i18n("Manual entry") : manual.description;
-        entry.sshArguments = manual.arguments;
-        entry.hostName = hostFromArguments(entry.sshArguments);
-        entry.userName.clear();
-        entry.origin = SshHelper::EntryOrigin::Manual;
-        entry.isManual = true;
-
-        if (m_seenIds.contains(entry.id)) {
-            for (SshTarget &existing : m_targets) {
-                if (existing.id == entry.id) {
-                    existing.defaultLabel = entry.defaultLabel;
-                    existing.label = entry.label;
-                    existing.description = entry.description;
-                    existing.sshArguments = entry.sshArguments;
-                    existing.hostName = entry.hostName;
-                    existing.userName = entry.userName;
-                    existing.origin = entry.origin;
-                    existing.isManual = true;
-                    break;
-                }
-            }
-        } else {
-            m_targets.push_back(std::move(entry));
-            m_seenIds.insert(manual.id);
+        const QString name = results.value(dnsAddress);
+        if (name.isEmpty()) {
+            continue;
+        }
+        if (!updated) {
+            updated = std::make_shared<HostSnapshot>(*current);
+            updated->generation = ++m_generation;
         }
+        SshTarget patched = updated->targets.at(i);
+        patched.dnsName = name;
+        buildSearchFields(patched);
+        updated->searchIndex.addEntry(i, patched.search);
+        updated->targets.replace(i, patched);
     }
 
-    for (SshTarget &target : m_targets) {
-        if (target.hostName.isEmpty()) {
-            target.hostName = hostFromArguments(target.sshArguments);
-        }
-        if (target.hostName.isEmpty()) {
-            target.hostName = target.defaultLabel;
-        }
-        target.dnsName = resolveDnsNameForHost(target.hostName);
+    if (updated) {
+        m_snapshot.store(std::move(updated));
     }
+}
 
-    const SshHelper::TerminalPreference terminalPref = SshHelper::loadTerminalPreference();
-    m_preferredTerminalId = terminalPref.id.isEmpty() ? QStringLiteral("auto") : terminalPref.id;
-    m_customTerminalCommand = terminalPref.customCommand.trimmed();
+void SshHelperRunner::updateWatchedPaths(const QString &sshDirPath, const QString &configPath, const QString &knownHostsPath, const QStringList &configIncludes)
+{
+    QStringList wanted = {sshDirPath, configPath, knownHostsPath};
+    wanted += configIncludes;
+    const QString helperConfig = SshHelper::configFilePath();
+    if (!helperConfig.isEmpty()) {
+        wanted << helperConfig;
+    }
 
-    std::sort(m_targets.begin(), m_targets.end(), [](const SshTarget &lhs, const SshTarget &rhs) {
-        return QString::localeAwareCompare(lhs.label, rhs.label) < 0;
-    });
+    // Only the difference is applied; files replaced by a rename dropped out of the watcher and come back here.
+    const QSet<QString> wantedSet(wanted.cbegin(), wanted.cend());
+    QStringList stale;
+    for (const QString &path : m_watcher.files() + m_watcher.directories()) {
+        if (!wantedSet.contains(path)) {
+            stale << path;
+        }
+    }
+    if (!stale.isEmpty()) {
+        m_watcher.removePaths(stale);
+    }
 
-    m_loaded = true;
+    const QStringList watched = m_watcher.files() + m_watcher.directories();
+    QStringList added;
+    for (const QString &path : std::as_const(wanted)) {
+        if (!watched.contains(path) && !added.contains(path) && QFileInfo::exists(path)) {
+            added << path;
+        }
+    }
+    if (!added.isEmpty()) {
+        m_watcher.addPaths(added);
+    }
 }
 
-bool SshHelperRunner::launchPreferredTerminal(const QStringList &arguments)
+
+bool SshHelperRunner::launchPreferredTerminal(SshHelper::ProcessLauncher &launcher,
+                                              const QElapsedTimer &sinceRun,
+                                              const SshHelper::TerminalPreference &terminal,
+                                              const QStringList &arguments)
 {
-    if (m_preferredTerminalId.isEmpty() || m_preferredTerminalId == QStringLiteral("auto")) {
+    const Launch launch{launcher, sinceRun};
+    if (terminal.id.isEmpty() || terminal.id == QStringLiteral("auto")) {
         return false;
     }
 
-    if (m_preferredTerminalId == QStringLiteral("custom")) {
-        return launchWithCustomDescriptor(m_customTerminalCommand, arguments);
+    if (terminal.id == QStringLiteral("custom")) {
+        return launchWithCustomDescriptor(launch, terminal.customCommand, arguments);
     }
 
-    if (m_preferredTerminalId == QStringLiteral("konsole")) {
-        return launchWithDashE(QStringLiteral("konsole"), arguments, {QStringLiteral("--noclose")});
+    if (terminal.id == QStringLiteral("konsole")) {
+        return launchWithDashE(launch, QStringLiteral("konsole"), arguments, {QStringLiteral("--noclose")});
     }
-    if (m_preferredTerminalId == QStringLiteral("gnome-terminal")) {
-        return launchWithDoubleDash(QStringLiteral("gnome-terminal"), arguments);
+    if (terminal.id == QStringLiteral("gnome-terminal")) {
+        return launchWithDoubleDash(launch, QStringLiteral("gnome-terminal"), arguments);
     }
-    if (m_preferredTerminalId == QStringLiteral("kgx")) {
-        return launchWithDoubleDash(QStringLiteral("kgx"), arguments);
+    if (terminal.id == QStringLiteral("kgx")) {
+        return launchWithDoubleDash(launch, QStringLiteral("kgx"), arguments);
     }
-    if (m_preferredTerminalId == QStringLiteral("xterm")) {
-        return launchWithDashE(QStringLiteral("xterm"), arguments, {QStringLiteral("-hold")});
+    if (terminal.id == QStringLiteral("xterm")) {
+        return launchWithDashE(launch, QStringLiteral("xterm"), arguments, {QStringLiteral("-hold")});
     }
-    if (m_preferredTerminalId == QStringLiteral("x-terminal-emulator")) {
-        return launchWithDashE(QStringLiteral("x-terminal-emulator"), arguments);
+    if (terminal.id == QStringLiteral("x-terminal-emulator")) {
+        return launchWithDashE(launch, QStringLiteral("x-terminal-emulator"), arguments);
     }
 
     static const QSet<QString> dashETerminals = {
@@ -767,11 +1443,11 @@ bool SshHelperRunner::launchPreferredTerminal(const QStringList &arguments)
         QStringLiteral("sakura")
     };
 
-    if (dashETerminals.contains(m_preferredTerminalId)) {
-        return launchWithDashE(m_preferredTerminalId, arguments);
+    if (dashETerminals.contains(terminal.id)) {
+        return launchWithDashE(launch, terminal.id, arguments);
     }
 
-    return launchWithCustomDescriptor(m_preferredTerminalId, arguments);
+    return launchWithCustomDescriptor(launch, terminal.id, arguments);
 }
 
 #include "sshhelper.moc"
@@ -8,60 +8,168 @@
 #include <KConfigWatcher>
 #include <KSharedConfig>
 
+#include "sshdiscovery.h"
+#include "sshdns.h"
+#include "sshfrecency.h"
 #include "sshhelper_common.h"
+#include "sshlauncher.h"
+#include "sshsearch.h"
+#include "sshsnapshot.h"
+#include "sshtargets.h"
 
+#include <QAtomicInt>
+#include <QCollator>
+#include <QElapsedTimer>
 #include <QFileSystemWatcher>
+#include <QFlags>
 #include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
 #include <QSet>
 #include <QString>
 #include <QStringList>
+#include <QThreadPool>
 #include <QTimer>
 #include <QVector>
 #include <QVariantList>
 
+#include <memory>
+#include <vector>
+
 class KConfigWatcher;
 
+namespace SshHelper
+{
+// A shared_ptr read by query threads and replaced by the reload thread. std::atomic<std::shared_ptr>
+// is missing from libc++ and takes a lock in libstdc++ anyway; here the lock only covers the
+// pointer copy, and a replaced value is released after it is dropped.
+template<typename T>
+class SharedSlot
+{
+public:
+    std::shared_ptr<T> load() const
+    {
+        QReadLocker locker(&m_lock);
+        return m_value;
+    }
+
+    void store(std::shared_ptr<T> value)
+    {
+        {
+            QWriteLocker locker(&m_lock);
+            m_value.swap(value);
+        }
+    }
+
+private:
+    mutable QReadWriteLock m_lock;
+    std::shared_ptr<T> m_value;
+};
+} // namespace SshHelper
+
 class SshHelperRunner : public KRunner::AbstractRunner
 {
     Q_OBJECT
 
 public:
     SshHelperRunner(QObject *parent, const KPluginMetaData &metaData, const QVariantList &args);
-    ~SshHelperRunner() override = default;
+    ~SshHelperRunner() override;
 
     void match(KRunner::RunnerContext &context) override;
     void run(const KRunner::RunnerContext &context, const KRunner::QueryMatch &match) override;
 
 private Q_SLOTS:
     void scheduleReload();
+    void watchedFileChanged(const QString &path);
+    void watchedDirectoryChanged();
+    void settingsChanged();
+    void mergeDnsResults(const QHash<QString, QString> &results);
+    void startBackgroundReload();
 
 private:
-    struct SshTarget {
-        QString id;
-        QString defaultLabel;
-        QString label;
-        QString description;
-        QStringList sshArguments;
-        QString hostName;
-        QString dnsName;
-        QString userName;
-        SshHelper::EntryOrigin origin;
-        bool isManual = false;
+    enum ReloadSource {
+        ConfigSource = 0x1,
+        KnownHostsSource = 0x2,
+        // krunner_sshhelperrc: labels, usernames, manual entries and the other settings.
+        SettingsSource = 0x4,
+        AllSources = ConfigSource | KnownHostsSource | SettingsSource
+    };
+    Q_DECLARE_FLAGS(ReloadSources, ReloadSource)
+
+    using SshTarget = SshHelper::SshTarget;
+
+    struct RefinementCache {
+        quint64 generation = 0;
+        QString searchText;
+        QString fullText;
+        QVector<int> survivors;
+        bool valid = false;
     };
 
-    void ensureHostsLoaded();
+    using HostSnapshot = SshHelper::HostSnapshot;
+
+    std::shared_ptr<const HostSnapshot> ensureHostsLoaded();
     void reloadHosts();
-    static QString normalized(const QString &text);
-    static double computeFuzzyScore(const QString &candidate, const QString &pattern);
+    void reloadHostsLocked();
+    void backgroundReload();
+    void applyDnsResults(const QHash<QString, QString> &results);
+    void scheduleSourceReload(ReloadSources sources);
+    bool reloadSettings();
+    void assembleSnapshot(const QByteArray &sourceKey);
+    void patchSettings(const HostSnapshot &current, const QByteArray &sourceKey);
+    void insertIntoOrder(HostSnapshot &snapshot, int slot) const;
+    void updateSortKeys(HostSnapshot &snapshot) const;
+    SshTarget makeDiscoveredTarget(const SshHelper::DiscoveredHost &host) const;
+    void finalizeTarget(SshTarget &target, QSet<QString> &pendingAddresses);
+    void appendKnownHosts(const HostSnapshot &current, const QByteArray &sourceKey);
+    qsizetype appendDiscoveredHosts(const HostSnapshot &current, const QVector<SshHelper::DiscoveredHost> &hosts, const QByteArray &sourceKey);
+    void queueHashedHostMerge();
+    void mergeHashedHosts();
+    QVector<SshHelper::DiscoveredHost> resolveHashedHosts();
+    bool loadPersistedSnapshot();
+    void revalidateSnapshot();
+    void persistSnapshot(const std::shared_ptr<const HostSnapshot> &snapshot);
+    void publishFrecency();
+    static QStringList sourcePaths();
+    void updateWatchedPaths(const QString &sshDirPath, const QString &configPath, const QString &knownHostsPath, const QStringList &configIncludes);
+    static void buildSearchFields(SshTarget &target);
     static QString hostFromArguments(const QStringList &arguments);
     static int hostArgumentIndex(const QStringList &arguments);
+    static QStringList argumentsForMatch(const QStringList &sshArguments, int hostArgument, const SshHelper::HostQuery &query);
     static QStringList applyUserToArguments(const QStringList &arguments, const QString &userName);
-    static QString normalizedHost(const QString &host);
-    QString resolveDnsNameForHost(const QString &host);
-    bool launchPreferredTerminal(const QStringList &arguments);
+    static bool launchPreferredTerminal(SshHelper::ProcessLauncher &launcher,
+                                        const QElapsedTimer &sinceRun,
+                                        const SshHelper::TerminalPreference &terminal,
+                                        const QStringList &arguments);
 
-    QVector<SshTarget> m_targets;
-    QSet<QString> m_seenIds;
+    SshHelper::SharedSlot<const HostSnapshot> m_snapshot;
+    QMutex m_reloadMutex;
+    QAtomicInt m_pendingSources = AllSources;
+    QAtomicInt m_reloadInFlight;
+    // Sources whose parsed state below is current; everything else is read on the next reload.
+    ReloadSources m_parsedSources;
+    QVector<SshHelper::DiscoveredHost> m_configHosts;
+    QStringList m_configIncludes;
+    QByteArray m_configStamps;
+    // Only used by the reload thread.
+    QCollator m_collator;
+    SshHelper::TerminalPreference m_terminal;
+    int m_maxResults = 0;
+    SshHelper::KnownHostsParser m_knownHosts;
+    SshHelper::HashedHostMatcher m_hashedHosts;
+    bool m_hashedHostsLoaded = false;
+    bool m_resolveHashedHosts = false;
+    bool m_hashedMergeQueued = false;
+    // Names tried against hashed known_hosts entries.
+    QSet<QString> m_hashCandidates;
+    quint64 m_generation = 0;
+    QMutex m_refinementMutex;
+    RefinementCache m_refinement;
+    SshHelper::LaunchHistory m_history;
+    // Launch boosts in [0, 1) by target id, replaced whenever a launch is recorded.
+    SshHelper::SharedSlot<const QHash<QString, double>> m_frecency;
+    QAtomicInt m_completedQueries;
+    QAtomicInt m_abortedQueries;
     QFileSystemWatcher m_watcher;
     QTimer m_reloadTimer;
     KSharedConfig::Ptr m_config;
@@ -69,9 +177,11 @@ private:
     QHash<QString, QString> m_customUsernames;
     QVector<SshHelper::ManualEntry> m_manualEntries;
     KConfigWatcher::Ptr m_configWatcher;
-    QString m_preferredTerminalId = QStringLiteral("auto");
-    QString m_customTerminalCommand;
-    QHash<QString, QString> m_dnsCache;
-    QSet<QString> m_dnsFailures;
-    bool m_loaded = false;
+    SshHelper::AsyncDnsResolver *m_dnsResolver = nullptr;
+    SshHelper::ProcessLauncher *m_launcher = nullptr;
+    SshHelper::DnsCache m_dnsCache;
+    // Single thread so snapshot writes land in publication order.
+    QThreadPool m_persistPool;
+    // Single thread running reloads and DNS merges, so queries never wait for a rebuild.
+    QThreadPool m_reloadPool;
 };
@@ -5,13 +5,22 @@
 #include <KSharedConfig>
 
 #include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
 #include <QProcess>
 #include <QStandardPaths>
 #include <QUuid>
 
 #include <iterator>
 
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace
 {
 constexpr auto s_configFileName = "krunner_sshhelperrc";
@@ -25,6 +34,69 @@ constexpr auto s_descriptionKey = "Description";
 constexpr auto s_terminalGroup = "Terminal";
 constexpr auto s_terminalIdKey = "Id";
 constexpr auto s_terminalCustomKey = "CustomCommand";
+constexpr auto s_dnsGroup = "Dns";
+constexpr auto s_dnsPositiveTtlKey = "PositiveTtl";
+constexpr auto s_dnsNegativeTtlKey = "NegativeTtl";
+constexpr auto s_knownHostsGroup = "KnownHosts";
+constexpr auto s_resolveHashedKey = "ResolveHashed";
+constexpr auto s_searchGroup = "Search";
+constexpr auto s_maxResultsKey = "MaxResults";
+
+// How long a PATH scan is trusted before the directory stamps are checked again.
+constexpr qint64 s_executableRevalidateMs = 2000;
+
+struct ExecutableCache {
+    QMutex mutex;
+    QByteArray path;
+    QByteArray stamps;
+    qint64 validatedAt = 0;
+    // First match in PATH order for every name found in a PATH directory.
+    QHash<QString, QString> executables;
+};
+
+ExecutableCache &executableCache()
+{
+    static ExecutableCache cache;
+    return cache;
+}
+
+QByteArray directoryStamps(const QStringList &directories)
+{
+    QByteArray stamps;
+    QDataStream stream(&stamps, QIODevice::WriteOnly);
+    for (const QString &directory : directories) {
+        struct stat info;
+        if (::stat(QFile::encodeName(directory).constData(), &info) == 0) {
+            stream << quint64(info.st_ino) << qint64(info.st_mtim.tv_sec) << qint64(info.st_mtim.tv_nsec);
+        } else {
+            stream << quint64(0) << qint64(-1) << qint64(-1);
+        }
+    }
+    return stamps;
+}
+
+// Lists names only; whether a file is executable is checked for the one that is asked for.
+void scanPathDirectories(const QStringList &directories, QHash<QString, QString> &executables)
+{
+    executables.clear();
+    for (const QString &directory : directories) {
+        DIR *dir = ::opendir(QFile::encodeName(directory).constData());
+        if (!dir) {
+            continue;
+        }
+        const QDir base(directory);
+        while (const dirent *entry = ::readdir(dir)) {
+            if (entry->d_type == DT_DIR || entry->d_name[0] == '.') {
+                continue;
+            }
+            const QString name = QFile::decodeName(entry->d_name);
+            if (!executables.contains(name)) {
+                executables.insert(name, base.absoluteFilePath(name));
+            }
+        }
+        ::closedir(dir);
+    }
+}
 
 struct TerminalCandidate {
     const char *id;
@@ -92,6 +164,15 @@ QString configFilePath()
     return QDir(configDir).filePath(QString::fromLatin1(s_configFileName));
 }
 
+QString cacheFilePath(const QString &fileName)
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (cacheDir.isEmpty()) {
+        return {};
+    }
+    return QDir(cacheDir).filePath(QStringLiteral("krunner_sshhelper/%1").arg(fileName));
+}
+
 QHash<QString, QString> loadCustomLabels()
 {
     QHash<QString, QString> result;
@@ -246,12 +327,50 @@ QString originDisplayLabel(EntryOrigin origin)
     return {};
 }
 
+QString findExecutable(const QString &name)
+{
+    if (name.isEmpty() || name.contains(QLatin1Char('/'))) {
+        return name.isEmpty() ? QString() : QStandardPaths::findExecutable(name);
+    }
+
+    ExecutableCache &cache = executableCache();
+    QMutexLocker locker(&cache.mutex);
+    const QByteArray path = qgetenv("PATH");
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (path != cache.path || now - cache.validatedAt > s_executableRevalidateMs) {
+        QStringList directories;
+        for (const QString &directory : QString::fromLocal8Bit(path).split(QLatin1Char(':'), Qt::SkipEmptyParts)) {
+            directories << QDir::cleanPath(directory);
+        }
+        const QByteArray stamps = directoryStamps(directories);
+        if (path != cache.path || stamps != cache.stamps) {
+            scanPathDirectories(directories, cache.executables);
+            cache.path = path;
+            cache.stamps = stamps;
+        }
+        cache.validatedAt = now;
+    }
+
+    const QString executable = cache.executables.value(name);
+    if (executable.isEmpty()) {
+        return {};
+    }
+    const QByteArray encoded = QFile::encodeName(executable);
+    struct stat info;
+    if (::stat(encoded.constData(), &info) != 0 || !S_ISREG(info.st_mode) || ::access(encoded.constData(), X_OK) != 0) {
+        // Shadowed by a non-executable file; let Qt walk the rest of PATH.
+        locker.unlock();
+        return QStandardPaths::findExecutable(name);
+    }
+    return executable;
+}
+
 QVector<TerminalOption> availableTerminalOptions()
 {
     QVector<TerminalOption> options;
     options.reserve(std::size(TERMINAL_CANDIDATES));
     for (const TerminalCandidate &candidate : TERMINAL_CANDIDATES) {
-        if (!QStandardPaths::findExecutable(QString::fromLatin1(candidate.executable)).isEmpty()) {
+        if (!findExecutable(QString::fromLatin1(candidate.executable)).isEmpty()) {
             TerminalOption option;
             option.id = QString::fromLatin1(candidate.id);
             option.displayName = QString::fromLatin1(candidate.displayName);
@@ -313,4 +432,44 @@ QString terminalDisplayNameForId(const QString &id)
     }
     return id;
 }
+
+DnsCacheSettings loadDnsCacheSettings()
+{
+    DnsCacheSettings settings;
+    const KSharedConfig::Ptr cfg = openConfig();
+    if (!cfg) {
+        return settings;
+    }
+
+    const KConfigGroup group(cfg, QString::fromLatin1(s_dnsGroup));
+    settings.positiveTtl = group.readEntry(QString::fromLatin1(s_dnsPositiveTtlKey), settings.positiveTtl);
+    settings.negativeTtl = group.readEntry(QString::fromLatin1(s_dnsNegativeTtlKey), settings.negativeTtl);
+    return settings;
+}
+
+KnownHostsSettings loadKnownHostsSettings()
+{
+    KnownHostsSettings settings;
+    const KSharedConfig::Ptr cfg = openConfig();
+    if (!cfg) {
+        return settings;
+    }
+
+    const KConfigGroup group(cfg, QString::fromLatin1(s_knownHostsGroup));
+    settings.resolveHashed = group.readEntry(QString::fromLatin1(s_resolveHashedKey), settings.resolveHashed);
+    return settings;
+}
+
+SearchSettings loadSearchSettings()
+{
+    SearchSettings settings;
+    const KSharedConfig::Ptr cfg = openConfig();
+    if (!cfg) {
+        return settings;
+    }
+
+    const KConfigGroup group(cfg, QString::fromLatin1(s_searchGroup));
+    settings.maxResults = group.readEntry(QString::fromLatin1(s_maxResultsKey), settings.maxResults);
+    return settings;
+}
 } // namespace SshHelper
@@ -18,6 +18,8 @@ struct ManualEntry {
     QString name;
     QString description;
     QStringList arguments;
+
+    bool operator==(const ManualEntry &other) const = default;
 };
 
 struct TerminalOption {
@@ -30,8 +32,23 @@ struct TerminalPreference {
     QString customCommand;
 };
 
+struct DnsCacheSettings {
+    qint64 positiveTtl = 7 * 24 * 60 * 60;
+    qint64 negativeTtl = 60 * 60;
+};
+
+struct SearchSettings {
+    // Zero or less means every match is reported.
+    int maxResults = 50;
+};
+
+struct KnownHostsSettings {
+    bool resolveHashed = true;
+};
+
 QString entryIdForArguments(const QStringList &arguments);
 QString configFilePath();
+QString cacheFilePath(const QString &fileName);
 QHash<QString, QString> loadCustomLabels();
 void saveCustomLabels(const QHash<QString, QString> &labels);
 QHash<QString, QString> loadCustomUsernames();
@@ -42,8 +59,13 @@ QString generateManualEntryId();
 QString argumentsToString(const QStringList &arguments);
 QStringList stringToArguments(const QString &command);
 QString originDisplayLabel(EntryOrigin origin);
+// Like QStandardPaths::findExecutable, but served from one cached scan of the PATH directories.
+QString findExecutable(const QString &name);
 QVector<TerminalOption> availableTerminalOptions();
 TerminalPreference loadTerminalPreference();
 void saveTerminalPreference(const TerminalPreference &preference);
 QString terminalDisplayNameForId(const QString &id);
+DnsCacheSettings loadDnsCacheSettings();
+KnownHostsSettings loadKnownHostsSettings();
+SearchSettings loadSearchSettings();
 } // namespace SshHelper
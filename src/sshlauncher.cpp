@@ -0,0 +1,154 @@
+#include "sshlauncher.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QProcess>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <csignal>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace
+{
+// A pidfd turns readable when the process exits, which lets the event loop reap it.
+int openPidFd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return int(::syscall(SYS_pidfd_open, pid, 0));
+#else
+    Q_UNUSED(pid);
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+bool pidFdSupported()
+{
+    static const bool supported = [] {
+        const int fd = openPidFd(::getpid());
+        if (fd < 0) {
+            return false;
+        }
+        ::close(fd);
+        return true;
+    }();
+    return supported;
+}
+} // namespace
+
+namespace SshHelper
+{
+ProcessLauncher::ProcessLauncher(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ProcessLauncher::~ProcessLauncher()
+{
+    // Children still running are left to init once KRunner exits; their descriptors are ours to close.
+    for (auto it = m_children.cbegin(); it != m_children.cend(); ++it) {
+        ::close(it.key());
+    }
+}
+
+int ProcessLauncher::startDetached(const QString &executable, const QStringList &arguments, QString *errorString)
+{
+    if (!pidFdSupported()) {
+        // Without pidfd there is no way to reap a direct child from the event loop; fall back to Qt's double fork.
+        QProcess process;
+        process.setProgram(executable);
+        process.setArguments(arguments);
+        if (process.startDetached()) {
+            return 0;
+        }
+        if (errorString) {
+            *errorString = process.errorString();
+        }
+        return UnknownError;
+    }
+
+    const QByteArray program = QFile::encodeName(executable);
+    QList<QByteArray> encoded;
+    encoded.reserve(arguments.size() + 1);
+    encoded << program;
+    for (const QString &argument : arguments) {
+        encoded << argument.toLocal8Bit();
+    }
+    std::vector<char *> argv;
+    argv.reserve(encoded.size() + 1);
+    for (QByteArray &argument : encoded) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes, &signals);
+    sigfillset(&signals);
+    posix_spawnattr_setsigdefault(&attributes, &signals);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+    flags |= POSIX_SPAWN_SETSID;
+#endif
+    posix_spawnattr_setflags(&attributes, flags);
+
+    // The environment is passed through as is; nothing is copied into a QProcessEnvironment.
+    pid_t pid = -1;
+    const int error = ::posix_spawn(&pid, program.constData(), nullptr, &attributes, argv.data(), environ);
+    posix_spawnattr_destroy(&attributes);
+    if (error != 0) {
+        if (errorString) {
+            *errorString = qt_error_string(error);
+        }
+        return error;
+    }
+
+    QMetaObject::invokeMethod(this, [this, pid]() {
+        watchChild(pid);
+    });
+    return 0;
+}
+
+LaunchStatistics ProcessLauncher::record(const QString &terminal, bool succeeded)
+{
+    QMutexLocker locker(&m_mutex);
+    LaunchStatistics &statistics = m_statistics[terminal];
+    if (succeeded) {
+        ++statistics.succeeded;
+    } else {
+        ++statistics.failed;
+    }
+    return statistics;
+}
+
+void ProcessLauncher::watchChild(pid_t pid)
+{
+    const int fd = openPidFd(pid);
+    if (fd < 0) {
+        // Already gone and waiting to be reaped.
+        ::waitpid(pid, nullptr, WNOHANG);
+        return;
+    }
+
+    m_children.insert(fd, pid);
+    auto *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, [this, notifier, fd]() {
+        notifier->setEnabled(false);
+        ::waitpid(m_children.take(fd), nullptr, WNOHANG);
+        ::close(fd);
+        notifier->deleteLater();
+    });
+}
+} // namespace SshHelper
+
+#include "moc_sshlauncher.cpp"
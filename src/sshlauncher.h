@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <sys/types.h>
+
+namespace SshHelper
+{
+struct LaunchStatistics {
+    int succeeded = 0;
+    int failed = 0;
+};
+
+// Starts programs with posix_spawn in their own session, so the large KRunner process is never
+// forked, and reaps them when they exit.
+class ProcessLauncher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProcessLauncher(QObject *parent = nullptr);
+    ~ProcessLauncher() override;
+
+    // Not an errno: the QProcess fallback failed and did not say why in errno terms.
+    static constexpr int UnknownError = -1;
+
+    // Returns 0 once the program has been executed, otherwise the errno describing why it was not, or
+    // UnknownError. errorString, when given, receives a readable reason on failure.
+    int startDetached(const QString &executable, const QStringList &arguments, QString *errorString = nullptr);
+
+    // Counts one launch outcome for a terminal and returns its totals so far.
+    LaunchStatistics record(const QString &terminal, bool succeeded);
+
+private:
+    void watchChild(pid_t pid);
+
+    QMutex m_mutex;
+    QHash<QString, LaunchStatistics> m_statistics;
+    QHash<int, pid_t> m_children;
+};
+} // namespace SshHelper
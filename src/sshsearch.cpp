@@ -0,0 +1,662 @@
+#include "sshsearch.h"
+#include "sshsearch_p.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(Q_PROCESSOR_X86) && (defined(Q_CC_GNU) || defined(Q_CC_CLANG))
+#define SSHHELPER_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define SSHHELPER_X86_KERNELS 0
+#endif
+
+namespace
+{
+constexpr qsizetype s_packedAlignment = SshHelper::Detail::PackedAlignment;
+
+using SshHelper::Detail::FindByteFunction;
+
+qsizetype findByteScalar(const char *data, qsizetype size, char needle, qsizetype from)
+{
+    if (from >= size) {
+        return -1;
+    }
+    const void *found = std::memchr(data + from, needle, static_cast<size_t>(size - from));
+    return found ? static_cast<const char *>(found) - data : -1;
+}
+
+#if SSHHELPER_X86_KERNELS
+// Both kernels rely on SearchField::packed being zero-padded to s_packedAlignment,
+// so whole vectors can be loaded and the padding never matches a pattern byte.
+__attribute__((target("sse2"))) qsizetype findByteSse2(const char *data, qsizetype size, char needle, qsizetype from)
+{
+    const __m128i wanted = _mm_set1_epi8(needle);
+    qsizetype block = from & ~qsizetype(15);
+    unsigned skip = static_cast<unsigned>(from - block);
+    for (; block < size; block += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + block));
+        const unsigned mask = (static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, wanted))) >> skip) << skip;
+        if (mask) {
+            return block + std::countr_zero(mask);
+        }
+        skip = 0;
+    }
+    return -1;
+}
+
+__attribute__((target("avx2"))) qsizetype findByteAvx2(const char *data, qsizetype size, char needle, qsizetype from)
+{
+    const __m256i wanted = _mm256_set1_epi8(needle);
+    qsizetype block = from & ~qsizetype(31);
+    unsigned skip = static_cast<unsigned>(from - block);
+    for (; block < size; block += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + block));
+        const quint64 mask = (static_cast<quint64>(static_cast<quint32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, wanted)))) >> skip) << skip;
+        if (mask) {
+            return block + std::countr_zero(mask);
+        }
+        skip = 0;
+    }
+    return -1;
+}
+#endif
+
+FindByteFunction selectFindByteKernel()
+{
+    if (qEnvironmentVariableIsSet("SSH_HELPER_SCALAR_SCORER")) {
+        return findByteScalar;
+    }
+#if SSHHELPER_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return findByteAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return findByteSse2;
+    }
+#endif
+    return findByteScalar;
+}
+
+FindByteFunction findByteKernel()
+{
+    static const FindByteFunction kernel = selectFindByteKernel();
+    return kernel;
+}
+
+// Greedy left-to-right walk shared by the UTF-16 and packed paths. It only decides whether the
+// pattern occurs as a subsequence; the alignment itself is scored by alignmentScore().
+template<typename FindNext>
+bool containsSubsequence(qsizetype patternSize, FindNext findNext)
+{
+    qsizetype previousIndex = -1;
+    for (qsizetype i = 0; i < patternSize; ++i) {
+        previousIndex = findNext(i, previousIndex + 1);
+        if (previousIndex < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isSubsequence(QStringView text, QStringView pattern)
+{
+    return containsSubsequence(pattern.size(), [text, pattern](qsizetype i, qsizetype from) {
+        return text.indexOf(pattern.at(i), from);
+    });
+}
+
+bool isPackedSubsequence(const SshHelper::SearchFieldView &field, const QByteArray &pattern)
+{
+    const FindByteFunction findByte = findByteKernel();
+    const char *data = field.packed;
+    const qsizetype size = field.text.size();
+    return containsSubsequence(pattern.size(), [findByte, data, size, &pattern](qsizetype i, qsizetype from) {
+        return findByte(data, size, pattern.at(i), from);
+    });
+}
+
+// Scoring constants of fzf's v2 algorithm.
+constexpr int s_scoreMatch = 16;
+constexpr int s_gapStart = -3;
+constexpr int s_gapExtension = -1;
+constexpr int s_bonusBoundary = s_scoreMatch / 2;
+constexpr int s_bonusNonWord = s_scoreMatch / 2;
+constexpr int s_bonusCamel123 = s_bonusBoundary + s_gapExtension;
+constexpr int s_bonusConsecutive = -(s_gapStart + s_gapExtension);
+constexpr int s_bonusBoundaryWhite = s_bonusBoundary + 2;
+constexpr int s_bonusBoundaryDelimiter = s_bonusBoundary + 1;
+constexpr int s_bonusFirstCharMultiplier = 2;
+constexpr int s_unreachable = std::numeric_limits<int>::min() / 2;
+// Floor for a token that occurs as a subsequence but whose alignment is dominated by gaps.
+constexpr double s_minimumSubsequenceScore = 0.01;
+// Subsequence scores stay below the substring tier (0.6 and up), however well the alignment hits boundaries.
+constexpr double s_maximumSubsequenceScore = 0.59;
+
+enum class CharClass : quint8 {
+    White,
+    NonWord,
+    Delimiter,
+    Lower,
+    Upper,
+    Letter,
+    Number
+};
+
+CharClass charClass(QChar c)
+{
+    if (c.isSpace()) {
+        return CharClass::White;
+    }
+    if (c.isLower()) {
+        return CharClass::Lower;
+    }
+    if (c.isUpper()) {
+        return CharClass::Upper;
+    }
+    if (c.isDigit()) {
+        return CharClass::Number;
+    }
+    if (c.isLetter()) {
+        return CharClass::Letter;
+    }
+    static constexpr QLatin1StringView delimiters("/,:;|.-_@");
+    return delimiters.contains(c) ? CharClass::Delimiter : CharClass::NonWord;
+}
+
+int positionBonus(CharClass previous, CharClass current)
+{
+    if (current > CharClass::Delimiter) {
+        switch (previous) {
+        case CharClass::White:
+            return s_bonusBoundaryWhite;
+        case CharClass::Delimiter:
+            return s_bonusBoundaryDelimiter;
+        case CharClass::NonWord:
+            return s_bonusBoundary;
+        default:
+            break;
+        }
+    }
+    if ((previous == CharClass::Lower && current == CharClass::Upper) || (previous != CharClass::Number && current == CharClass::Number)) {
+        return s_bonusCamel123;
+    }
+    if (current == CharClass::NonWord || current == CharClass::Delimiter) {
+        return s_bonusNonWord;
+    }
+    if (current == CharClass::White) {
+        return s_bonusBoundaryWhite;
+    }
+    return 0;
+}
+
+// Character classes come from the original text so camelCase survives case folding; when folding
+// changed the length the folded text is used instead.
+QByteArray bonusTable(QStringView folded, QStringView original)
+{
+    const QStringView source = original.size() == folded.size() ? original : folded;
+    QByteArray bonus(source.size(), Qt::Uninitialized);
+    CharClass previous = CharClass::White;
+    for (qsizetype i = 0; i < source.size(); ++i) {
+        const CharClass current = charClass(source.at(i));
+        bonus[i] = static_cast<char>(positionBonus(previous, current));
+        previous = current;
+    }
+    return bonus;
+}
+
+int maximumAlignmentScore(qsizetype patternSize)
+{
+    return int(patternSize) * (s_scoreMatch + s_bonusBoundaryWhite) + s_bonusBoundaryWhite * (s_bonusFirstCharMultiplier - 1);
+}
+
+// Smith-Waterman style alignment in the manner of fzf v2: every occurrence of each pattern
+// character is considered, so the best-placed one wins instead of the first one.
+int alignmentScore(QStringView text, const quint8 *bonus, QStringView pattern)
+{
+    const qsizetype size = text.size();
+
+    // Six rows per call, carved out of a per-thread buffer that only grows, so scoring never allocates
+    // once the longest field has been seen.
+    thread_local std::vector<int> scratch;
+    if (scratch.size() < size_t(6 * size)) {
+        scratch.resize(size_t(6 * size));
+    }
+    int *score = scratch.data();
+    int *nextScore = score + size;
+    // Length of the consecutive run ending in a cell, and the bonus that run started with.
+    int *run = nextScore + size;
+    int *nextRun = run + size;
+    int *runBonus = nextRun + size;
+    int *nextRunBonus = runBonus + size;
+
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        const QChar wanted = pattern.at(i);
+        int left = s_unreachable;
+        bool leftIsGap = false;
+        for (qsizetype j = 0; j < size; ++j) {
+            int matched = s_unreachable;
+            int matchedRun = 0;
+            int matchedRunBonus = 0;
+            if (j >= i && text.at(j) == wanted) {
+                const int diagonal = i == 0 ? 0 : (j > 0 ? score[j - 1] : s_unreachable);
+                if (diagonal > s_unreachable) {
+                    int positional = bonus[j];
+                    if (i == 0) {
+                        positional *= s_bonusFirstCharMultiplier;
+                        matchedRun = 1;
+                        matchedRunBonus = bonus[j];
+                    } else if (run[j - 1] > 0) {
+                        matchedRun = run[j - 1] + 1;
+                        matchedRunBonus = runBonus[j - 1];
+                        if (bonus[j] >= s_bonusBoundary && bonus[j] > matchedRunBonus) {
+                            matchedRunBonus = bonus[j];
+                        }
+                        positional = std::max({positional, matchedRunBonus, s_bonusConsecutive});
+                    } else {
+                        matchedRun = 1;
+                        matchedRunBonus = bonus[j];
+                    }
+                    matched = diagonal + s_scoreMatch + positional;
+                }
+            }
+
+            const int gap = left > s_unreachable ? left + (leftIsGap ? s_gapExtension : s_gapStart) : s_unreachable;
+            if (matched > s_unreachable && matched >= gap) {
+                nextScore[j] = matched;
+                nextRun[j] = matchedRun;
+                nextRunBonus[j] = matchedRunBonus;
+                leftIsGap = false;
+            } else {
+                nextScore[j] = gap;
+                nextRun[j] = 0;
+                nextRunBonus[j] = 0;
+                leftIsGap = gap > s_unreachable;
+            }
+            left = nextScore[j];
+        }
+        std::swap(score, nextScore);
+        std::swap(run, nextRun);
+        std::swap(runBonus, nextRunBonus);
+    }
+
+    int best = s_unreachable;
+    for (qsizetype j = 0; j < size; ++j) {
+        best = qMax(best, score[j]);
+    }
+    return best;
+}
+
+// Only called once the greedy walk found the token as a subsequence. Gap penalties can push the
+// alignment to zero or below, but the field still matches: dropping it here would make a longer
+// query match where its prefix did not, which the refinement cache in the runner relies on.
+double subsequenceScore(const SshHelper::SearchFieldView &field, QStringView token)
+{
+    const int score = alignmentScore(field.text, field.bonus, token);
+    const double alignment = static_cast<double>(score) / static_cast<double>(maximumAlignmentScore(token.size()));
+    return qBound(s_minimumSubsequenceScore, s_maximumSubsequenceScore * alignment, s_maximumSubsequenceScore);
+}
+
+bool isPackable(QStringView text)
+{
+    for (const QChar c : text) {
+        if (c.unicode() == 0 || c.unicode() >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray packedCopy(QStringView text, qsizetype alignment)
+{
+    QByteArray packed = text.toLatin1();
+    const qsizetype padded = qMax<qsizetype>(alignment, (packed.size() + alignment - 1) / alignment * alignment);
+    packed.resize(padded, '\0');
+    return packed;
+}
+} // namespace
+
+namespace SshHelper
+{
+QList<Detail::FindByteKernel> Detail::supportedFindByteKernels()
+{
+    QList<FindByteKernel> kernels{{"scalar", findByteScalar}};
+#if SSHHELPER_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        kernels.push_back({"sse2", findByteSse2});
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({"avx2", findByteAvx2});
+    }
+#endif
+    return kernels;
+}
+
+void SearchIndex::clear()
+{
+    m_postings.clear();
+    m_size = 0;
+}
+
+void SearchIndex::addEntry(int slot, const SearchFields &fields)
+{
+    addField(slot, fields.label.text);
+    addField(slot, fields.arguments.text);
+    addField(slot, fields.description.text);
+    addField(slot, fields.defaultLabel.text);
+    addField(slot, fields.dnsName.text);
+    addField(slot, fields.userName.text);
+    addField(slot, fields.userHost.text);
+    m_size = qMax(m_size, slot + 1);
+}
+
+int SearchIndex::size() const
+{
+    return m_size;
+}
+
+void SearchIndex::addField(int slot, QStringView text)
+{
+    const qsizetype word = slot / 64;
+    const quint64 bit = quint64(1) << (slot % 64);
+    for (const QChar c : text) {
+        QVector<quint64> &posting = m_postings[c.unicode()];
+        if (posting.size() <= word) {
+            posting.resize(word + 1);
+        }
+        posting[word] |= bit;
+    }
+}
+
+void SearchIndex::orTokenMatches(QStringView token, QVector<quint64> &mask) const
+{
+    QVector<const QVector<quint64> *> postings;
+    postings.reserve(token.size());
+    qsizetype words = mask.size();
+    for (const QChar c : token) {
+        const auto it = m_postings.constFind(c.unicode());
+        if (it == m_postings.cend()) {
+            return;
+        }
+        postings.push_back(&it.value());
+        words = qMin(words, it.value().size());
+    }
+    if (postings.isEmpty()) {
+        return;
+    }
+
+    for (qsizetype word = 0; word < words; ++word) {
+        quint64 bits = ~quint64(0);
+        for (const QVector<quint64> *posting : std::as_const(postings)) {
+            bits &= posting->at(word);
+            if (!bits) {
+                break;
+            }
+        }
+        mask[word] |= bits;
+    }
+}
+
+bool SearchIndex::collectCandidates(const QList<const SearchQuery *> &queries, QVector<int> &matches) const
+{
+    matches.clear();
+    for (const SearchQuery *query : queries) {
+        if (query->text.size() < MinimumPrunedQueryLength) {
+            return false;
+        }
+    }
+
+    QVector<quint64> mask((m_size + 63) / 64, 0);
+    for (const SearchQuery *query : queries) {
+        for (const QString &token : query->tokens) {
+            orTokenMatches(token, mask);
+        }
+    }
+
+    for (qsizetype word = 0; word < mask.size(); ++word) {
+        quint64 bits = mask.at(word);
+        while (bits) {
+            matches.push_back(static_cast<int>(word * 64 + std::countr_zero(bits)));
+            bits &= bits - 1;
+        }
+    }
+    return true;
+}
+
+QString normalizedSearchText(const QString &text)
+{
+    return text.simplified().toCaseFolded();
+}
+
+SearchField searchField(const QString &text)
+{
+    SearchField field;
+    field.text = normalizedSearchText(text);
+    field.bonus = bonusTable(field.text, text.simplified());
+    if (!field.text.isEmpty() && isPackable(field.text)) {
+        field.packed = packedCopy(field.text, s_packedAlignment);
+    }
+    return field;
+}
+
+SearchQuery compileSearchQuery(const QString &pattern)
+{
+    SearchQuery query;
+    query.text = normalizedSearchText(pattern);
+    query.tokens = query.text.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    if (isPackable(query.text)) {
+        query.packedTokens.reserve(query.tokens.size());
+        for (const QString &token : std::as_const(query.tokens)) {
+            query.packedTokens.push_back(token.toLatin1());
+        }
+    }
+    return query;
+}
+
+HostQuery parseHostQuery(const QString &text)
+{
+    HostQuery query;
+    QStringList terms;
+    for (const QString &term : text.split(QLatin1Char(' '), Qt::SkipEmptyParts)) {
+        const qsizetype colon = term.indexOf(QLatin1Char(':'));
+        if (colon > 0 && colon < term.size() - 1) {
+            const QStringView key = QStringView(term).first(colon);
+            const QStringView value = QStringView(term).sliced(colon + 1);
+            if (key.compare(u"origin", Qt::CaseInsensitive) == 0) {
+                if (value.compare(u"config", Qt::CaseInsensitive) == 0) {
+                    query.origin = EntryOrigin::Config;
+                    continue;
+                }
+                if (value.compare(u"known_hosts", Qt::CaseInsensitive) == 0 || value.compare(u"knownhosts", Qt::CaseInsensitive) == 0) {
+                    query.origin = EntryOrigin::KnownHosts;
+                    continue;
+                }
+                if (value.compare(u"manual", Qt::CaseInsensitive) == 0) {
+                    query.origin = EntryOrigin::Manual;
+                    continue;
+                }
+            } else if (key.compare(u"user", Qt::CaseInsensitive) == 0) {
+                query.userFilter = value.toString();
+                continue;
+            }
+        }
+        terms.push_back(term);
+    }
+
+    QString host = terms.join(QLatin1Char(' '));
+    const qsizetype atIndex = host.indexOf(QLatin1Char('@'));
+    if (atIndex > 0 && atIndex < host.size() - 1 && !QStringView(host).first(atIndex).contains(QLatin1Char(' '))) {
+        query.user = host.left(atIndex);
+        host = host.mid(atIndex + 1).trimmed();
+    }
+
+    // A bare IPv6 address has colons of its own; only "[addr]:port" carries a port there.
+    const qsizetype colon = host.lastIndexOf(QLatin1Char(':'));
+    if (colon > 0 && colon < host.size() - 1) {
+        const QStringView prefix = QStringView(host).first(colon);
+        bool ok = false;
+        const int port = QStringView(host).sliced(colon + 1).toInt(&ok);
+        if (ok && port > 0 && port < 65536 && (!prefix.contains(QLatin1Char(':')) || (prefix.startsWith(u'[') && prefix.endsWith(u']')))) {
+            query.port = port;
+            host.truncate(colon);
+        }
+    }
+    // The brackets only set the address apart from the port; the bare address matches both
+    // "[addr]:port" known_hosts entries and plain ones.
+    if (host.size() > 2 && host.startsWith(QLatin1Char('[')) && host.endsWith(QLatin1Char(']'))) {
+        host = host.mid(1, host.size() - 2);
+    }
+
+    query.searchText = host;
+    query.fullText = query.user.isEmpty() ? host : query.user + QLatin1Char('@') + host;
+    return query;
+}
+
+SearchFieldView::SearchFieldView(const SearchField &field)
+    : text(field.text)
+    , packed(field.packed.isEmpty() ? nullptr : field.packed.constData())
+    , bonus(reinterpret_cast<const quint8 *>(field.bonus.constData()))
+{
+}
+
+SearchFieldView::SearchFieldView(QStringView text, const char *packed, const quint8 *bonus)
+    : text(text)
+    , packed(packed)
+    , bonus(bonus)
+{
+}
+
+double fuzzyScore(const SearchFieldView &field, const SearchQuery &query)
+{
+    const QStringView candidate(field.text);
+    const QStringView pattern(query.text);
+    if (candidate.isEmpty() || pattern.isEmpty()) {
+        return 0.0;
+    }
+
+    if (candidate == pattern) {
+        return 1.0;
+    }
+
+    if (candidate.startsWith(pattern)) {
+        const double proximity = static_cast<double>(pattern.size()) / static_cast<double>(candidate.size());
+        return qBound(0.0, 0.8 + (0.2 * proximity), 1.0);
+    }
+
+    if (candidate.contains(pattern)) {
+        const double proximity = static_cast<double>(pattern.size()) / static_cast<double>(candidate.size());
+        return qBound(0.0, 0.6 + (0.2 * proximity), 1.0);
+    }
+
+    if (query.tokens.isEmpty()) {
+        return 0.0;
+    }
+
+    // The vectorized greedy walk rejects most candidates before the alignment runs.
+    const bool packed = field.packed && query.packedTokens.size() == query.tokens.size();
+    double total = 0.0;
+    for (qsizetype i = 0; i < query.tokens.size(); ++i) {
+        const QString &token = query.tokens.at(i);
+        if (token.size() > candidate.size()) {
+            continue;
+        }
+        if (packed ? isPackedSubsequence(field, query.packedTokens.at(i)) : isSubsequence(candidate, token)) {
+            total += subsequenceScore(field, token);
+        }
+    }
+    return qBound(0.0, total / query.tokens.size(), 1.0);
+}
+
+ApproximatePattern compileApproximatePattern(QStringView pattern)
+{
+    ApproximatePattern compiled;
+    if (pattern.isEmpty() || pattern.size() > 64) {
+        return compiled;
+    }
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        const char16_t c = pattern.at(i).unicode();
+        const quint64 bit = quint64(1) << i;
+        if (c < compiled.asciiMasks.size()) {
+            compiled.asciiMasks[c] |= bit;
+        } else {
+            compiled.otherMasks[c] |= bit;
+        }
+    }
+    compiled.size = int(pattern.size());
+    return compiled;
+}
+
+int approximateDistance(const SearchFieldView &field, const ApproximatePattern &pattern, int maxDistance)
+{
+    if (pattern.size == 0 || maxDistance < 0 || field.text.isEmpty()) {
+        return -1;
+    }
+
+    // Myers' bit-vector algorithm with a free start position in the text, so the distance is to
+    // the best-matching substring. Transpositions count as two edits.
+    const quint64 last = quint64(1) << (pattern.size - 1);
+    quint64 positive = ~quint64(0);
+    quint64 negative = 0;
+    int score = pattern.size;
+    int best = score;
+    for (const QChar c : field.text) {
+        const char16_t unit = c.unicode();
+        const quint64 equal = unit < pattern.asciiMasks.size() ? pattern.asciiMasks[unit] : pattern.otherMasks.value(unit);
+        const quint64 vertical = equal | negative;
+        const quint64 horizontal = (((equal & positive) + positive) ^ positive) | equal;
+        quint64 horizontalPositive = negative | ~(horizontal | positive);
+        quint64 horizontalNegative = positive & horizontal;
+        if (horizontalPositive & last) {
+            ++score;
+        } else if (horizontalNegative & last) {
+            --score;
+        }
+        horizontalPositive <<= 1;
+        horizontalNegative <<= 1;
+        positive = horizontalNegative | ~(vertical | horizontalPositive);
+        negative = horizontalPositive & vertical;
+        best = qMin(best, score);
+    }
+    return best <= maxDistance ? best : -1;
+}
+
+QDataStream &operator<<(QDataStream &stream, const SearchField &field)
+{
+    return stream << field.text << field.packed << field.bonus;
+}
+
+QDataStream &operator>>(QDataStream &stream, SearchField &field)
+{
+    return stream >> field.text >> field.packed >> field.bonus;
+}
+
+QDataStream &operator<<(QDataStream &stream, const SearchFields &fields)
+{
+    return stream << fields.label << fields.arguments << fields.description << fields.defaultLabel << fields.dnsName << fields.userName << fields.userHost;
+}
+
+QDataStream &operator>>(QDataStream &stream, SearchFields &fields)
+{
+    return stream >> fields.label >> fields.arguments >> fields.description >> fields.defaultLabel >> fields.dnsName >> fields.userName >> fields.userHost;
+}
+
+QDataStream &operator<<(QDataStream &stream, const SearchIndex &index)
+{
+    return stream << qint32(index.m_size) << index.m_postings;
+}
+
+QDataStream &operator>>(QDataStream &stream, SearchIndex &index)
+{
+    qint32 size = 0;
+    stream >> size >> index.m_postings;
+    index.m_size = size;
+    return stream;
+}
+} // namespace SshHelper
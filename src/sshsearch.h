@@ -0,0 +1,115 @@
+#pragma once
+
+#include "sshhelper_common.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+#include <array>
+#include <optional>
+
+namespace SshHelper
+{
+struct SearchField {
+    QString text;
+    // Zero-padded ASCII copy of text for the vectorized scorer; empty when text is not pure ASCII.
+    QByteArray packed;
+    // Alignment bonus for a match at each position of text (word boundaries, camelCase).
+    QByteArray bonus;
+};
+
+// Non-owning view of a SearchField, or of one stored in a TargetTable's arena.
+struct SearchFieldView {
+    SearchFieldView() = default;
+    SearchFieldView(const SearchField &field);
+    SearchFieldView(QStringView text, const char *packed, const quint8 *bonus);
+
+    QStringView text;
+    // Zero-padded to a multiple of 32 bytes; null when text is not pure ASCII.
+    const char *packed = nullptr;
+    // One entry per character of text.
+    const quint8 *bonus = nullptr;
+};
+
+struct SearchFields {
+    SearchField label;
+    SearchField arguments;
+    SearchField description;
+    SearchField defaultLabel;
+    SearchField dnsName;
+    SearchField userName;
+    SearchField userHost;
+};
+
+struct SearchQuery {
+    QString text;
+    QStringList tokens;
+    QList<QByteArray> packedTokens;
+
+    bool isEmpty() const { return text.isEmpty(); }
+};
+
+// The text after the trigger word, split into what is searched and what changes the launch.
+struct HostQuery {
+    // Host part without the user, port and IPv6 brackets, matched against every field.
+    QString searchText;
+    // user@host as typed (without the port or brackets), matched against the user@host field.
+    QString fullText;
+    QString user;
+    int port = -1;
+    std::optional<EntryOrigin> origin;
+    QString userFilter;
+};
+
+// Pattern bitmasks for the bit-parallel approximate matcher; size is 0 when the pattern does not fit in one word.
+struct ApproximatePattern {
+    std::array<quint64, 128> asciiMasks{};
+    QHash<char16_t, quint64> otherMasks;
+    int size = 0;
+};
+
+class SearchIndex
+{
+public:
+    static constexpr qsizetype MinimumPrunedQueryLength = 3;
+
+    void clear();
+    void addEntry(int slot, const SearchFields &fields);
+    int size() const;
+
+    bool collectCandidates(const QList<const SearchQuery *> &queries, QVector<int> &matches) const;
+
+private:
+    void addField(int slot, QStringView text);
+    void orTokenMatches(QStringView token, QVector<quint64> &mask) const;
+
+    QHash<char16_t, QVector<quint64>> m_postings;
+    int m_size = 0;
+
+    friend QDataStream &operator<<(QDataStream &stream, const SearchIndex &index);
+    friend QDataStream &operator>>(QDataStream &stream, SearchIndex &index);
+};
+
+QDataStream &operator<<(QDataStream &stream, const SearchField &field);
+QDataStream &operator>>(QDataStream &stream, SearchField &field);
+QDataStream &operator<<(QDataStream &stream, const SearchFields &fields);
+QDataStream &operator>>(QDataStream &stream, SearchFields &fields);
+QDataStream &operator<<(QDataStream &stream, const SearchIndex &index);
+QDataStream &operator>>(QDataStream &stream, SearchIndex &index);
+
+QString normalizedSearchText(const QString &text);
+SearchField searchField(const QString &text);
+SearchQuery compileSearchQuery(const QString &pattern);
+// Understands "user@host", a trailing ":port" on the host, and the filters "origin:<config|known_hosts|manual>" and "user:<name>".
+HostQuery parseHostQuery(const QString &text);
+double fuzzyScore(const SearchFieldView &candidate, const SearchQuery &query);
+ApproximatePattern compileApproximatePattern(QStringView pattern);
+// Fewest edits turning the pattern into some substring of the field, or -1 when that takes more than maxDistance.
+int approximateDistance(const SearchFieldView &field, const ApproximatePattern &pattern, int maxDistance);
+} // namespace SshHelper
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QList>
+#include <QtGlobal>
+
+// Internals of sshsearch.cpp that the autotests exercise directly.
+namespace SshHelper::Detail
+{
+using FindByteFunction = qsizetype (*)(const char *data, qsizetype size, char needle, qsizetype from);
+
+// SearchField::packed is zero-padded to a multiple of this, so vector kernels may load whole blocks.
+constexpr qsizetype PackedAlignment = 32;
+
+struct FindByteKernel {
+    const char *name;
+    FindByteFunction function;
+};
+
+// The scalar kernel, which SSH_HELPER_SCALAR_SCORER forces, followed by every vector kernel this CPU runs.
+QList<FindByteKernel> supportedFindByteKernels();
+} // namespace SshHelper::Detail
@@ -0,0 +1,131 @@
+#include "sshsnapshot.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSaveFile>
+
+#include <sys/stat.h>
+
+namespace
+{
+constexpr quint32 s_snapshotMagic = 0x53534853; // "SSHS"
+constexpr quint16 s_snapshotVersion = 5;
+} // namespace
+
+namespace SshHelper
+{
+QByteArray fileStamps(const QStringList &paths)
+{
+    QByteArray stamps;
+    QDataStream stream(&stamps, QIODevice::WriteOnly);
+    for (const QString &path : paths) {
+        struct stat info;
+        if (::stat(QFile::encodeName(path).constData(), &info) == 0) {
+            stream << quint64(info.st_ino) << qint64(info.st_mtim.tv_sec) << qint64(info.st_mtim.tv_nsec) << qint64(info.st_size);
+        } else {
+            stream << quint64(0) << qint64(-1) << qint64(-1) << qint64(-1);
+        }
+    }
+    return stamps;
+}
+
+QByteArray sourceStampKey(const QStringList &paths)
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << QLocale().name();
+    return key + fileStamps(paths);
+}
+
+void updateRanks(HostSnapshot &snapshot)
+{
+    snapshot.rankBySlot.resize(snapshot.targets.size());
+    for (int rank = 0; rank < snapshot.order.size(); ++rank) {
+        snapshot.rankBySlot[snapshot.order.at(rank)] = rank;
+    }
+}
+
+std::shared_ptr<HostSnapshot> readSnapshotFile(const QString &filePath, const QStringList &sourcePaths)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) {
+        return {};
+    }
+    const uchar *mapped = file.map(0, file.size());
+    if (!mapped) {
+        return {};
+    }
+
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), file.size());
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != s_snapshotMagic || version != s_snapshotVersion) {
+        return {};
+    }
+    auto snapshot = std::make_shared<HostSnapshot>();
+    stream >> snapshot->configIncludes >> snapshot->sourceKey;
+    if (stream.status() != QDataStream::Ok || snapshot->sourceKey != sourceStampKey(sourcePaths) + fileStamps(snapshot->configIncludes)) {
+        return {};
+    }
+
+    quint32 count = 0;
+    qint32 maxResults = 0;
+    stream >> snapshot->terminal.id >> snapshot->terminal.customCommand >> maxResults >> count;
+    snapshot->maxResults = maxResults;
+    if (stream.status() != QDataStream::Ok || count > quint32(data.size())) {
+        return {};
+    }
+
+    snapshot->targets.reserve(count);
+    snapshot->slotById.reserve(count);
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        SshTarget target;
+        quint8 origin = 0;
+        qint32 hostArgument = -1;
+        stream >> target.id >> target.defaultLabel >> target.label >> target.description >> target.sshArguments >> target.hostName >> target.dnsName
+            >> target.dnsAddress >> target.userName >> origin >> target.isManual >> hostArgument >> target.search;
+        target.origin = static_cast<EntryOrigin>(origin);
+        target.hostArgument = hostArgument >= -1 && hostArgument < target.sshArguments.size() ? hostArgument : -1;
+        snapshot->slotById.insert(target.id, snapshot->targets.append(target));
+    }
+    stream >> snapshot->order >> snapshot->searchIndex;
+    if (stream.status() != QDataStream::Ok || snapshot->order.size() != snapshot->targets.size() || snapshot->searchIndex.size() > snapshot->targets.size()) {
+        return {};
+    }
+    for (const int slot : std::as_const(snapshot->order)) {
+        if (slot < 0 || slot >= snapshot->targets.size()) {
+            return {};
+        }
+    }
+    updateRanks(*snapshot);
+    return snapshot;
+}
+
+bool writeSnapshotFile(const QString &filePath, const HostSnapshot &snapshot)
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << s_snapshotMagic << s_snapshotVersion << snapshot.configIncludes << snapshot.sourceKey;
+    stream << snapshot.terminal.id << snapshot.terminal.customCommand << qint32(snapshot.maxResults) << static_cast<quint32>(snapshot.targets.size());
+    for (int i = 0; i < snapshot.targets.size(); ++i) {
+        const SshTarget target = snapshot.targets.at(i);
+        stream << target.id << target.defaultLabel << target.label << target.description << target.sshArguments << target.hostName << target.dnsName
+               << target.dnsAddress << target.userName << static_cast<quint8>(target.origin) << target.isManual << qint32(target.hostArgument) << target.search;
+    }
+    stream << snapshot.order << snapshot.searchIndex;
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+} // namespace SshHelper
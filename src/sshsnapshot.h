@@ -0,0 +1,52 @@
+#pragma once
+
+#include "sshhelper_common.h"
+#include "sshsearch.h"
+#include "sshtargets.h"
+
+#include <QByteArray>
+#include <QCollatorSortKey>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+namespace SshHelper
+{
+// Everything a query reads, published as one immutable value and persisted for the next start.
+struct HostSnapshot {
+    quint64 generation = 0;
+    TargetTable targets;
+    QHash<QString, int> slotById;
+    // Collation keys of the labels by slot; missing after loading a persisted snapshot, see SshHelperRunner::updateSortKeys().
+    std::vector<QCollatorSortKey> sortKeys;
+    // Slots in display (label) order.
+    QVector<int> order;
+    // Position of each slot in order, the tie-break between equally relevant matches.
+    QVector<int> rankBySlot;
+    SearchIndex searchIndex;
+    TerminalPreference terminal;
+    int maxResults = 0;
+    // Files and directories reached through Include in ~/.ssh/config.
+    QStringList configIncludes;
+    // Stamps of the source files this snapshot was built from, see sourceStampKey().
+    QByteArray sourceKey;
+};
+
+// Inode, mtime and size of each path, without reading any of them.
+QByteArray fileStamps(const QStringList &paths);
+// Identifies the exact revision of every source file. The locale is part of the key because it
+// decides the label order and the translated descriptions.
+QByteArray sourceStampKey(const QStringList &paths);
+
+// Rebuilds rankBySlot from order.
+void updateRanks(HostSnapshot &snapshot);
+
+// Returns null unless the file holds a well-formed snapshot of the current revision of sourcePaths
+// and of the includes it recorded. sortKeys is left empty.
+std::shared_ptr<HostSnapshot> readSnapshotFile(const QString &filePath, const QStringList &sourcePaths);
+bool writeSnapshotFile(const QString &filePath, const HostSnapshot &snapshot);
+} // namespace SshHelper
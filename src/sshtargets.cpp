@@ -0,0 +1,250 @@
+#include "sshtargets.h"
+#include "sshsearch_p.h"
+
+#include <iterator>
+#include <utility>
+
+namespace
+{
+// Arenas smaller than this are never compacted; the copy would cost more than the slack.
+constexpr qsizetype s_minimumCompactSize = 64 * 1024;
+
+qsizetype paddedSize(qsizetype size)
+{
+    const qsizetype alignment = SshHelper::Detail::PackedAlignment;
+    return qMax(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+// In TargetTable::Field order.
+SshHelper::SearchField SshHelper::SearchFields::*const s_fields[] = {
+    &SshHelper::SearchFields::label,
+    &SshHelper::SearchFields::arguments,
+    &SshHelper::SearchFields::description,
+    &SshHelper::SearchFields::defaultLabel,
+    &SshHelper::SearchFields::dnsName,
+    &SshHelper::SearchFields::userName,
+    &SshHelper::SearchFields::userHost,
+};
+} // namespace
+
+namespace SshHelper
+{
+static_assert(std::size(s_fields) == TargetTable::FieldCount);
+
+int TargetTable::size() const
+{
+    return m_ids.size();
+}
+
+bool TargetTable::isEmpty() const
+{
+    return m_ids.isEmpty();
+}
+
+void TargetTable::reserve(int size)
+{
+    m_spans.reserve(size * FieldCount);
+    m_origins.reserve(size);
+    m_flags.reserve(size);
+    m_hostArguments.reserve(size);
+    m_ids.reserve(size);
+    m_labels.reserve(size);
+    m_defaultLabels.reserve(size);
+    m_descriptions.reserve(size);
+    m_arguments.reserve(size);
+    m_hostNames.reserve(size);
+    m_dnsNames.reserve(size);
+    m_dnsAddresses.reserve(size);
+    m_userNames.reserve(size);
+}
+
+int TargetTable::append(const SshTarget &target)
+{
+    const int slot = size();
+    m_spans.resize(m_spans.size() + FieldCount);
+    m_origins.push_back(target.origin);
+    m_flags.push_back(0);
+    m_hostArguments.push_back(-1);
+    m_ids.emplace_back();
+    m_labels.emplace_back();
+    m_defaultLabels.emplace_back();
+    m_descriptions.emplace_back();
+    m_arguments.emplace_back();
+    m_hostNames.emplace_back();
+    m_dnsNames.emplace_back();
+    m_dnsAddresses.emplace_back();
+    m_userNames.emplace_back();
+    store(slot, target);
+    return slot;
+}
+
+void TargetTable::replace(int slot, const SshTarget &target)
+{
+    store(slot, target);
+}
+
+SshTarget TargetTable::at(int slot) const
+{
+    SshTarget target;
+    target.id = m_ids.at(slot);
+    target.defaultLabel = m_defaultLabels.at(slot);
+    target.label = m_labels.at(slot);
+    target.description = m_descriptions.at(slot);
+    target.sshArguments = m_arguments.at(slot);
+    target.hostName = m_hostNames.at(slot);
+    target.dnsName = m_dnsNames.at(slot);
+    target.dnsAddress = m_dnsAddresses.at(slot);
+    target.userName = m_userNames.at(slot);
+    target.origin = m_origins.at(slot);
+    target.isManual = m_flags.at(slot) & ManualFlag;
+    target.hostArgument = m_hostArguments.at(slot);
+    target.search = searchFields(slot);
+    return target;
+}
+
+SearchFieldView TargetTable::field(int slot, Field field) const
+{
+    const FieldSpan &span = m_spans.at(slot * FieldCount + field);
+    return {QStringView(m_text).sliced(span.offset, span.size),
+            span.packed < 0 ? nullptr : m_packed.constData() + span.packed,
+            reinterpret_cast<const quint8 *>(m_bonus.constData()) + span.offset};
+}
+
+SearchFields TargetTable::searchFields(int slot) const
+{
+    SearchFields fields;
+    for (int i = 0; i < FieldCount; ++i) {
+        fields.*s_fields[i] = fieldAt(m_spans.at(slot * FieldCount + i));
+    }
+    return fields;
+}
+
+EntryOrigin TargetTable::origin(int slot) const
+{
+    return m_origins.at(slot);
+}
+
+bool TargetTable::isManual(int slot) const
+{
+    return m_flags.at(slot) & ManualFlag;
+}
+
+int TargetTable::hostArgument(int slot) const
+{
+    return m_hostArguments.at(slot);
+}
+
+const QString &TargetTable::id(int slot) const
+{
+    return m_ids.at(slot);
+}
+
+const QString &TargetTable::label(int slot) const
+{
+    return m_labels.at(slot);
+}
+
+const QString &TargetTable::defaultLabel(int slot) const
+{
+    return m_defaultLabels.at(slot);
+}
+
+const QString &TargetTable::description(int slot) const
+{
+    return m_descriptions.at(slot);
+}
+
+const QStringList &TargetTable::sshArguments(int slot) const
+{
+    return m_arguments.at(slot);
+}
+
+const QString &TargetTable::dnsName(int slot) const
+{
+    return m_dnsNames.at(slot);
+}
+
+const QString &TargetTable::dnsAddress(int slot) const
+{
+    return m_dnsAddresses.at(slot);
+}
+
+const QString &TargetTable::userName(int slot) const
+{
+    return m_userNames.at(slot);
+}
+
+void TargetTable::store(int slot, const SshTarget &target)
+{
+    for (int i = 0; i < FieldCount; ++i) {
+        FieldSpan &span = m_spans[slot * FieldCount + i];
+        m_garbage += span.size;
+        storeField(span, target.search.*s_fields[i]);
+    }
+    if (m_garbage > m_text.size() / 2 && m_text.size() > s_minimumCompactSize) {
+        compact();
+    }
+    m_origins[slot] = target.origin;
+    m_flags[slot] = target.isManual ? ManualFlag : 0;
+    m_hostArguments[slot] = target.hostArgument;
+    m_ids[slot] = target.id;
+    m_labels[slot] = target.label;
+    m_defaultLabels[slot] = target.defaultLabel;
+    m_descriptions[slot] = target.description;
+    m_arguments[slot] = target.sshArguments;
+    m_hostNames[slot] = target.hostName;
+    m_dnsNames[slot] = target.dnsName;
+    m_dnsAddresses[slot] = target.dnsAddress;
+    m_userNames[slot] = target.userName;
+}
+
+void TargetTable::storeField(FieldSpan &span, const SearchField &field)
+{
+    const qsizetype size = field.text.size();
+    span.offset = qint32(m_text.size());
+    span.size = qint32(size);
+    span.packed = -1;
+    m_text.append(field.text);
+    // Fields read back from a snapshot file are not trusted to have a bonus per character.
+    m_bonus.append(field.bonus.first(qMin(size, field.bonus.size())));
+    m_bonus.resize(m_text.size(), '\0');
+    // The vector kernels read whole blocks past the end, so the padding is restored here too.
+    if (size > 0 && field.packed.size() >= size) {
+        span.packed = qint32(m_packed.size());
+        m_packed.append(field.packed.first(size));
+        m_packed.resize(span.packed + paddedSize(size), '\0');
+    }
+}
+
+SearchField TargetTable::fieldAt(const FieldSpan &span) const
+{
+    SearchField field;
+    field.text = m_text.sliced(span.offset, span.size);
+    field.bonus = m_bonus.sliced(span.offset, span.size);
+    if (span.packed >= 0) {
+        field.packed = m_packed.sliced(span.packed, paddedSize(span.size));
+    }
+    return field;
+}
+
+void TargetTable::compact()
+{
+    const QString text = std::exchange(m_text, {});
+    const QByteArray bonus = std::exchange(m_bonus, {});
+    const QByteArray packed = std::exchange(m_packed, {});
+    m_text.reserve(text.size() - m_garbage);
+    m_bonus.reserve(text.size() - m_garbage);
+    for (FieldSpan &span : m_spans) {
+        const qint32 offset = qint32(m_text.size());
+        m_text.append(QStringView(text).sliced(span.offset, span.size));
+        m_bonus.append(QByteArrayView(bonus).sliced(span.offset, span.size));
+        span.offset = offset;
+        if (span.packed >= 0) {
+            const qint32 packedOffset = qint32(m_packed.size());
+            m_packed.append(QByteArrayView(packed).sliced(span.packed, paddedSize(span.size)));
+            span.packed = packedOffset;
+        }
+    }
+    m_garbage = 0;
+}
+} // namespace SshHelper
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "sshhelper_common.h"
+#include "sshsearch.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace SshHelper
+{
+// One launchable host. Only used while building or patching a TargetTable.
+struct SshTarget {
+    QString id;
+    QString defaultLabel;
+    QString label;
+    QString description;
+    QStringList sshArguments;
+    QString hostName;
+    QString dnsName;
+    QString dnsAddress;
+    QString userName;
+    EntryOrigin origin = EntryOrigin::Config;
+    bool isManual = false;
+    // Index of the destination in sshArguments, or -1.
+    int hostArgument = -1;
+    SearchFields search;
+};
+
+// Column store of targets indexed by slot. The fields read while scoring are copied into one
+// arena (text, bonus and packed bytes back to back) and addressed by a span per slot and field,
+// so a scan walks contiguous memory instead of chasing a QString per field.
+class TargetTable
+{
+public:
+    enum Field : quint8 {
+        LabelField,
+        ArgumentsField,
+        DescriptionField,
+        DefaultLabelField,
+        DnsNameField,
+        UserNameField,
+        UserHostField,
+        FieldCount
+    };
+
+    int size() const;
+    bool isEmpty() const;
+    void reserve(int size);
+
+    int append(const SshTarget &target);
+    void replace(int slot, const SshTarget &target);
+    SshTarget at(int slot) const;
+
+    // Valid until the table is next modified.
+    SearchFieldView field(int slot, Field field) const;
+    SearchFields searchFields(int slot) const;
+    EntryOrigin origin(int slot) const;
+    bool isManual(int slot) const;
+    int hostArgument(int slot) const;
+    const QString &id(int slot) const;
+    const QString &label(int slot) const;
+    const QString &defaultLabel(int slot) const;
+    const QString &description(int slot) const;
+    const QStringList &sshArguments(int slot) const;
+    const QString &dnsName(int slot) const;
+    const QString &dnsAddress(int slot) const;
+    const QString &userName(int slot) const;
+
+private:
+    enum Flag : quint8 {
+        ManualFlag = 0x1
+    };
+
+    struct FieldSpan {
+        qint32 offset = 0;
+        qint32 size = 0;
+        // Offset into m_packed, or -1 when the field has no packed copy.
+        qint32 packed = -1;
+    };
+
+    void store(int slot, const SshTarget &target);
+    void storeField(FieldSpan &span, const SearchField &field);
+    SearchField fieldAt(const FieldSpan &span) const;
+    void compact();
+
+    // Scored text of every field; m_bonus has one byte per character of it at the same offset.
+    QString m_text;
+    QByteArray m_bonus;
+    QByteArray m_packed;
+    // FieldCount spans per slot.
+    QVector<FieldSpan> m_spans;
+    // Characters of m_text that replaced fields left behind, reclaimed by compact().
+    qsizetype m_garbage = 0;
+    QVector<EntryOrigin> m_origins;
+    QVector<quint8> m_flags;
+    QVector<qint32> m_hostArguments;
+    QVector<QString> m_ids;
+    QVector<QString> m_labels;
+    QVector<QString> m_defaultLabels;
+    QVector<QString> m_descriptions;
+    QVector<QStringList> m_arguments;
+    QVector<QString> m_hostNames;
+    QVector<QString> m_dnsNames;
+    QVector<QString> m_dnsAddresses;
+    QVector<QString> m_userNames;
+};
+} // namespace SshHelper